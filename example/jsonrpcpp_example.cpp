@@ -16,37 +16,37 @@ using namespace std;
 jsonrpcpp::Parser parser;
 
 
-jsonrpcpp::Response getResponse(jsonrpcpp::request_ptr request)
+jsonrpcpp::Response getResponse(const jsonrpcpp::Request& request)
 {
-    // cout << " Request: " << request->method << ", id: " << request->id << ", has params: " << !request->params().is_null() << "\n";
-    if (request->method() == "subtract")
+    // cout << " Request: " << request.method << ", id: " << request.id << ", has params: " << !request.params().is_null() << "\n";
+    if (request.method() == "subtract")
     {
-        if (request->params())
+        if (request.params())
         {
             int result;
-            if (request->params().is_array())
-                result = request->params().get<int>(0) - request->params().get<int>(1);
+            if (request.params().is_array())
+                result = request.params().get<int>(0) - request.params().get<int>(1);
             else
-                result = request->params().get<int>("minuend") - request->params().get<int>("subtrahend");
+                result = request.params().get<int>("minuend") - request.params().get<int>("subtrahend");
 
-            return jsonrpcpp::Response(*request, result);
+            return jsonrpcpp::Response(request, result);
         }
-        throw jsonrpcpp::InvalidParamsException(*request);
+        throw jsonrpcpp::InvalidParamsException(request);
     }
-    else if (request->method() == "sum")
+    else if (request.method() == "sum")
     {
         int result = 0;
-        for (const auto& summand : request->params().param_array)
+        for (const auto& summand : request.params().value())
             result += summand.get<int>();
-        return jsonrpcpp::Response(*request, result);
+        return jsonrpcpp::Response(request, result);
     }
-    else if (request->method() == "get_data")
+    else if (request.method() == "get_data")
     {
-        return jsonrpcpp::Response(*request, Json({"hello", 5}));
+        return jsonrpcpp::Response(request, Json({"hello", 5}));
     }
     else
     {
-        throw jsonrpcpp::MethodNotFoundException(*request);
+        throw jsonrpcpp::MethodNotFoundException(request);
     }
 }
 
@@ -57,37 +57,37 @@ void test(const std::string& json_str)
     try
     {
         cout << "--> " << json_str << "\n";
-        jsonrpcpp::entity_ptr entity = parser.parse(json_str);
+        jsonrpcpp::AnyEntity entity = parser.parse_any(json_str);
         if (entity)
         {
-            // cout << " Json: " << entity->to_json().dump() << "\n";
-            if (entity->is_response())
+            // cout << " Json: " << entity.to_json().dump() << "\n";
+            if (entity.is_response())
             {
-                cout << "<-- " << entity->to_json().dump() << "\n";
+                cout << "<-- " << entity.to_json().dump() << "\n";
             }
-            if (entity->is_request())
+            if (entity.is_request())
             {
-                jsonrpcpp::Response response = getResponse(dynamic_pointer_cast<jsonrpcpp::Request>(entity));
+                jsonrpcpp::Response response = getResponse(entity.as_request());
                 cout << "<-- " << response.to_json().dump() << "\n";
             }
-            else if (entity->is_notification())
+            else if (entity.is_notification())
             {
-                jsonrpcpp::notification_ptr notification = dynamic_pointer_cast<jsonrpcpp::Notification>(entity);
-                cout << "Notification: " << notification->method() << ", has params: " << !notification->params().is_null() << "\n";
+                const jsonrpcpp::Notification& notification = entity.as_notification();
+                cout << "Notification: " << notification.method() << ", has params: " << !notification.params().is_null() << "\n";
             }
-            else if (entity->is_batch())
+            else if (entity.is_batch())
             {
-                jsonrpcpp::batch_ptr batch = dynamic_pointer_cast<jsonrpcpp::Batch>(entity);
+                const jsonrpcpp::Batch& batch = entity.as_batch();
                 jsonrpcpp::Batch responseBatch;
                 // cout << " Batch\n";
-                for (const auto& batch_entity : batch->entities)
+                for (const auto& batch_entity : batch.entities)
                 {
                     // cout << batch_entity->type_str() << ": \t" << batch_entity->to_json() << "\n";
                     if (batch_entity->is_request())
                     {
                         try
                         {
-                            jsonrpcpp::Response response = getResponse(dynamic_pointer_cast<jsonrpcpp::Request>(batch_entity));
+                            jsonrpcpp::Response response = getResponse(*static_pointer_cast<jsonrpcpp::Request>(batch_entity));
                             responseBatch.add(response); //<jsonrpcpp::Response>
                         }
                         catch (const jsonrpcpp::RequestException& e)
@@ -101,7 +101,7 @@ void test(const std::string& json_str)
                     }
                     else if (batch_entity->is_error())
                     {
-                        jsonrpcpp::error_ptr error = dynamic_pointer_cast<jsonrpcpp::Error>(batch_entity);
+                        jsonrpcpp::error_ptr error = static_pointer_cast<jsonrpcpp::Error>(batch_entity);
                         responseBatch.add(jsonrpcpp::RequestException(*error));
                     }
                 }
@@ -160,7 +160,7 @@ void foobar(const jsonrpcpp::Parameter& params)
 jsonrpcpp::response_ptr sum(const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params)
 {
     int result = 0;
-    for (const auto& summand : params.param_array)
+    for (const auto& summand : params.value())
         result += summand.get<int>();
     cout << "Request callback: sum, result: " << result << "\n";
     return make_shared<jsonrpcpp::Response>(id, result);
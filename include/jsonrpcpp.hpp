@@ -26,1343 +26,6962 @@
 #include <json.hpp>
 
 // standard headers
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+#if (defined(__cplusplus) && (__cplusplus >= 201703L)) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L))
+#define JSONRPCPP_HAS_CPP_17
+#include <memory_resource>
+#include <string_view>
+#endif
 
-using Json = nlohmann::json;
+// SIMD instruction sets for scanning (see find_newline), define JSONRPCPP_NO_SIMD to use plain C++
+#ifndef JSONRPCPP_NO_SIMD
+#if defined(__AVX2__)
+#define JSONRPCPP_HAS_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define JSONRPCPP_HAS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define JSONRPCPP_HAS_NEON
+#include <arm_neon.h>
+#endif
+#if defined(_MSC_VER) && (defined(JSONRPCPP_HAS_SSE2) || defined(JSONRPCPP_HAS_NEON))
+#include <intrin.h>
+#endif
+#endif
 
-namespace jsonrpcpp
-{
+// struct iovec for IovecBuffer::to_iovec (writev)
+#if defined(__unix__) || defined(__APPLE__)
+#define JSONRPCPP_HAS_IOVEC
+#include <sys/uio.h>
+#endif
 
-class Entity;
-class Request;
-class Notification;
-class Parameter;
-class Response;
-class Error;
-class Batch;
+#ifdef JSONRPCPP_USE_SIMDJSON
+#ifndef JSONRPCPP_HAS_CPP_17
+#error "JSONRPCPP_USE_SIMDJSON requires C++17"
+#endif
+#include <simdjson.h>
+#endif
 
-using entity_ptr = std::shared_ptr<Entity>;
-using request_ptr = std::shared_ptr<Request>;
-using notification_ptr = std::shared_ptr<Notification>;
-using parameter_ptr = std::shared_ptr<Parameter>;
-using response_ptr = std::shared_ptr<Response>;
-using error_ptr = std::shared_ptr<Error>;
-using batch_ptr = std::shared_ptr<Batch>;
+// worker threads for Parser::do_parse_parallel, which is only available with JSONRPCPP_USE_THREADS
+#ifdef JSONRPCPP_USE_THREADS
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
 
 
-class Entity
+namespace jsonrpcpp
+{
+
+/// Sorted associative container in a single contiguous block
+/**
+ * Elements are kept sorted by key in one array, so small maps need a single
+ * allocation instead of one node per key, and lookups are a binary search over
+ * adjacent memory. The first insertion reserves room for initial_capacity elements.
+ * Meets the requirements of nlohmann::basic_json's ObjectType (see flat_json),
+ * which is why the elements can't be stored inside the map itself: basic_json
+ * is still incomplete when its object type is instantiated.
+ * Lookup is heterogeneous if Compare is transparent (e.g. std::less<>).
+ * Like std::vector, inserting and erasing invalidates iterators.
+ */
+template <class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+class flat_map
 {
 public:
-    enum class entity_t : uint8_t
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+    enum : size_type
     {
-        unknown,
-        exception,
-        id,
-        error,
-        response,
-        request,
-        notification,
-        batch
+        initial_capacity = 8
     };
 
-    Entity(entity_t type);
-    virtual ~Entity() = default;
-    Entity(const Entity&) = default;
-    Entity& operator=(const Entity&) = default;
-
-    bool is_exception() const;
-    bool is_id() const;
-    bool is_error() const;
-    bool is_response() const;
-    bool is_request() const;
-    bool is_notification() const;
-    bool is_batch() const;
-
-    virtual std::string type_str() const;
+    flat_map() : data_(nullptr), size_(0), capacity_(0)
+    {
+    }
 
-    virtual Json to_json() const = 0;
-    virtual void parse_json(const Json& json) = 0;
+    explicit flat_map(const Allocator& alloc) : data_(nullptr), size_(0), capacity_(0), alloc_(alloc)
+    {
+    }
 
-    virtual void parse(const std::string& json_str);
-    virtual void parse(const char* json_str);
+    template <class InputIt>
+    flat_map(InputIt first, InputIt last, const Allocator& alloc = Allocator()) : flat_map(alloc)
+    {
+        insert(first, last);
+    }
 
-protected:
-    entity_t entity;
-};
+    flat_map(std::initializer_list<value_type> init, const Allocator& alloc = Allocator()) : flat_map(init.begin(), init.end(), alloc)
+    {
+    }
 
+    flat_map(const flat_map& other) : flat_map(std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.alloc_))
+    {
+        reserve(other.size_);
+        for (const auto& element : other)
+            construct(data_ + size_++, element);
+    }
 
-class NullableEntity : public Entity
-{
-public:
-    NullableEntity(entity_t type);
-    NullableEntity(entity_t type, std::nullptr_t);
-#ifdef _MSC_VER
-    virtual operator bool() const
-#else
-    virtual explicit operator bool() const
-#endif
+    flat_map(flat_map&& other) : flat_map(other.alloc_)
     {
-        return !isNull;
+        steal(other);
     }
 
-protected:
-    bool isNull;
-};
+    ~flat_map()
+    {
+        clear();
+        release();
+    }
 
+    flat_map& operator=(const flat_map& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            reserve(other.size_);
+            for (const auto& element : other)
+                construct(data_ + size_++, element);
+        }
+        return *this;
+    }
 
-class Id : public Entity
-{
-public:
-    enum class value_t : uint8_t
+    flat_map& operator=(flat_map&& other)
     {
-        null,
-        string,
-        integer
-    };
+        if (this != &other)
+        {
+            clear();
+            release();
+            steal(other);
+        }
+        return *this;
+    }
 
-    Id();
-    Id(int id);
-    Id(const char* id);
-    Id(const std::string& id);
-    Id(const Json& json_id);
+    iterator begin() noexcept
+    {
+        return data_;
+    }
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+    const_iterator begin() const noexcept
+    {
+        return data_;
+    }
 
-    friend std::ostream& operator<<(std::ostream& out, const Id& id)
+    const_iterator cbegin() const noexcept
     {
-        out << id.to_json();
-        return out;
+        return data_;
     }
 
-    const value_t& type() const
+    iterator end() noexcept
     {
-        return type_;
+        return data_ + size_;
     }
 
-    int int_id() const
+    const_iterator end() const noexcept
     {
-        return int_id_;
+        return data_ + size_;
     }
 
-    const std::string& string_id() const
+    const_iterator cend() const noexcept
     {
-        return string_id_;
+        return data_ + size_;
     }
 
-    bool operator<(const Id& other) const
+    bool empty() const noexcept
     {
-        return (to_json() < other.to_json());
+        return (size_ == 0);
     }
 
-protected:
-    value_t type_;
-    int int_id_;
-    std::string string_id_;
-};
+    size_type size() const noexcept
+    {
+        return size_;
+    }
 
+    size_type max_size() const noexcept
+    {
+        return std::allocator_traits<allocator_type>::max_size(alloc_);
+    }
 
-class Parameter : public NullableEntity
-{
-public:
-    enum class value_t : uint8_t
+    void clear() noexcept
     {
-        null,
-        array,
-        map
-    };
+        for (size_type n = 0; n < size_; ++n)
+            destroy(data_ + n);
+        size_ = 0;
+    }
 
-    Parameter(std::nullptr_t);
-    Parameter(const Json& json = nullptr);
-    Parameter(const std::string& key1, const Json& value1, const std::string& key2 = "", const Json& value2 = nullptr, const std::string& key3 = "",
-              const Json& value3 = nullptr, const std::string& key4 = "", const Json& value4 = nullptr);
+    void reserve(size_type capacity)
+    {
+        if (capacity <= capacity_)
+            return;
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+        value_type* data = std::allocator_traits<allocator_type>::allocate(alloc_, capacity);
+        for (size_type n = 0; n < size_; ++n)
+        {
+            construct(data + n, std::move(data_[n]));
+            destroy(data_ + n);
+        }
+        release();
+        data_ = data;
+        capacity_ = capacity;
+    }
 
-    bool is_array() const;
-    bool is_map() const;
-    bool is_null() const;
+    template <class K>
+    iterator lower_bound(const K& key)
+    {
+        return std::lower_bound(begin(), end(), key, [this](const value_type& element, const K& k) { return compare_(element.first, k); });
+    }
 
-    Json get(const std::string& key) const;
-    Json get(size_t idx) const;
-    bool has(const std::string& key) const;
-    bool has(size_t idx) const;
+    template <class K>
+    const_iterator lower_bound(const K& key) const
+    {
+        return std::lower_bound(begin(), end(), key, [this](const value_type& element, const K& k) { return compare_(element.first, k); });
+    }
 
-    void add(const std::string& key, const Json& value);
+    iterator find(const key_type& key)
+    {
+        return find_impl(key);
+    }
 
-    template <typename T>
-    T get(const std::string& key) const
+    const_iterator find(const key_type& key) const
     {
-        return get(key).get<T>();
+        return const_cast<flat_map*>(this)->find_impl(key);
     }
 
-    template <typename T>
-    T get(size_t idx) const
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    iterator find(const K& key)
     {
-        return get(idx).get<T>();
+        return find_impl(key);
     }
 
-    template <typename T>
-    T get(const std::string& key, const T& default_value) const
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    const_iterator find(const K& key) const
     {
-        if (!has(key))
-            return default_value;
-        return get<T>(key);
+        return const_cast<flat_map*>(this)->find_impl(key);
     }
 
-    template <typename T>
-    T get(size_t idx, const T& default_value) const
+    size_type count(const key_type& key) const
     {
-        if (!has(idx))
-            return default_value;
-        return get<T>(idx);
+        return (find(key) != end()) ? 1 : 0;
     }
 
-    value_t type;
-    std::vector<Json> param_array;
-    std::map<std::string, Json> param_map;
-};
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    size_type count(const K& key) const
+    {
+        return (find(key) != end()) ? 1 : 0;
+    }
 
+    T& at(const key_type& key)
+    {
+        return at_impl(key);
+    }
 
-class Error : public NullableEntity
-{
-public:
-    Error(const Json& json = nullptr);
-    Error(std::nullptr_t);
-    Error(const std::string& message, int code, const Json& data = nullptr);
+    const T& at(const key_type& key) const
+    {
+        return const_cast<flat_map*>(this)->at_impl(key);
+    }
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    T& at(const K& key)
+    {
+        return at_impl(key);
+    }
 
-    int code() const
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    const T& at(const K& key) const
     {
-        return code_;
+        return const_cast<flat_map*>(this)->at_impl(key);
     }
 
-    const std::string& message() const
+    T& operator[](const key_type& key)
     {
-        return message_;
+        return emplace(key).first->second;
     }
 
-    const Json& data() const
+    T& operator[](key_type&& key)
     {
-        return data_;
+        return emplace(std::move(key)).first->second;
     }
 
-protected:
-    int code_;
-    std::string message_;
-    Json data_;
-};
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    T& operator[](K&& key)
+    {
+        return emplace(std::forward<K>(key)).first->second;
+    }
 
+    /// Insert an element constructed from args, if key doesn't exist yet
+    template <class K, class... Args>
+    std::pair<iterator, bool> emplace(K&& key, Args&&... args)
+    {
+        iterator it = lower_bound(key);
+        if ((it != end()) && !compare_(key, it->first))
+            return {it, false};
+        return {insert_at(static_cast<size_type>(it - begin()), std::forward<K>(key), std::forward<Args>(args)...), true};
+    }
 
-/// JSON-RPC 2.0 request
-/**
- * Simple jsonrpc 2.0 parser with getters
- * Currently no named parameters are supported, but only array parameters
- */
-class Request : public Entity
-{
-public:
-    Request(const Json& json = nullptr);
-    Request(const Id& id, const std::string& method, const Parameter& params = nullptr);
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return emplace(value.first, value.second);
+    }
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+    std::pair<iterator, bool> insert(value_type&& value)
+    {
+        return emplace(value.first, std::move(value.second));
+    }
 
-    const std::string& method() const
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
     {
-        return method_;
+        for (; first != last; ++first)
+            insert(*first);
     }
 
-    const Parameter& params() const
+    iterator erase(iterator pos)
     {
-        return params_;
+        return erase(pos, pos + 1);
     }
 
-    const Id& id() const
+    iterator erase(const_iterator pos)
     {
-        return id_;
+        return erase(pos, pos + 1);
     }
 
-protected:
-    std::string method_;
-    Parameter params_;
-    Id id_;
-};
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        iterator target = begin() + (first - begin());
+        size_type count = static_cast<size_type>(last - first);
+        if (count == 0)
+            return target;
 
+        // keys are const, so the elements are moved by re-constructing them
+        for (iterator it = target; it + count != end(); ++it)
+        {
+            destroy(it);
+            construct(it, std::move(*(it + count)));
+        }
+        for (size_type n = size_ - count; n < size_; ++n)
+            destroy(data_ + n);
+        size_ -= count;
+        return target;
+    }
 
-class RpcException : public std::exception
-{
-public:
-    RpcException(const char* text);
-    RpcException(const std::string& text);
+    size_type erase(const key_type& key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
 
-    const char* what() const noexcept override;
+    template <class K, class C = Compare, class = typename C::is_transparent>
+    size_type erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
 
-protected:
-    std::runtime_error m_;
-};
+    friend bool operator==(const flat_map& lhs, const flat_map& rhs)
+    {
+        return (lhs.size() == rhs.size()) && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    friend bool operator!=(const flat_map& lhs, const flat_map& rhs)
+    {
+        return !(lhs == rhs);
+    }
 
+    friend bool operator<(const flat_map& lhs, const flat_map& rhs)
+    {
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
 
-class RpcEntityException : public RpcException, public Entity
+private:
+    template <class... Args>
+    void construct(value_type* p, Args&&... args)
+    {
+        std::allocator_traits<allocator_type>::construct(alloc_, p, std::forward<Args>(args)...);
+    }
+
+    void destroy(value_type* p)
+    {
+        std::allocator_traits<allocator_type>::destroy(alloc_, p);
+    }
+
+    /// Free the storage, the map must be empty
+    void release()
+    {
+        if (data_ != nullptr)
+            std::allocator_traits<allocator_type>::deallocate(alloc_, data_, capacity_);
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    /// Take over the elements of other, which must be allocator-compatible, this map must be empty
+    void steal(flat_map& other)
+    {
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    template <class K>
+    iterator find_impl(const K& key)
+    {
+        iterator it = lower_bound(key);
+        if ((it != end()) && !compare_(key, it->first))
+            return it;
+        return end();
+    }
+
+    template <class K>
+    T& at_impl(const K& key)
+    {
+        iterator it = find_impl(key);
+        if (it == end())
+            throw std::out_of_range("key not found");
+        return it->second;
+    }
+
+    template <class K, class... Args>
+    iterator insert_at(size_type idx, K&& key, Args&&... args)
+    {
+        if (size_ == capacity_)
+            reserve((capacity_ == 0) ? size_type(initial_capacity) : 2 * capacity_);
+        // keys are const, so the elements are moved by re-constructing them
+        for (size_type n = size_; n > idx; --n)
+        {
+            construct(data_ + n, std::move(data_[n - 1]));
+            destroy(data_ + n - 1);
+        }
+        construct(data_ + idx, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+        ++size_;
+        return data_ + idx;
+    }
+
+    value_type* data_;
+    size_type size_;
+    size_type capacity_;
+    allocator_type alloc_;
+    Compare compare_;
+};
+
+/// nlohmann::basic_json that stores objects in a flat_map
+using flat_json = nlohmann::basic_json<flat_map>;
+
+
+#ifdef JSONRPCPP_HAS_CPP_17
+/// @return the memory resource of the current thread (see MemoryResourceScope), std::pmr::get_default_resource() if there is none
+std::pmr::memory_resource* current_memory_resource();
+
+
+/// Makes a memory resource the current memory resource of the thread while it exists
+/**
+ * Entities created by the Parser, entities created with make_entity and pmr_json
+ * values are allocated from the current memory resource. With a std::pmr::monotonic_buffer_resource
+ * all allocations of a request/response cycle can be released at once, once the last
+ * entity and value allocated from it is destroyed.
+ * Scopes can be nested, the previous resource is restored on destruction.
+ */
+class MemoryResourceScope
 {
 public:
-    RpcEntityException(const Error& error);
-    RpcEntityException(const std::string& text);
-    Json to_json() const override = 0;
+    explicit MemoryResourceScope(std::pmr::memory_resource* resource);
+    ~MemoryResourceScope();
 
-    const Error& error() const
+    MemoryResourceScope(const MemoryResourceScope&) = delete;
+    MemoryResourceScope& operator=(const MemoryResourceScope&) = delete;
+
+    /// The resource of the innermost scope of this thread, nullptr outside of any scope
+    static std::pmr::memory_resource*& active();
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+
+/// Allocator that allocates from the current memory resource
+/**
+ * nlohmann::basic_json default-constructs its allocator for every allocation and
+ * deallocation, so the allocator can't carry the resource from one to the other.
+ * Each block stores the resource it was allocated from in front of the element,
+ * any resource_allocator can deallocate it.
+ */
+template <typename T>
+class resource_allocator
+{
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    resource_allocator() noexcept : resource_(current_memory_resource())
     {
-        return error_;
     }
 
-protected:
-    void parse_json(const Json& json) override;
-    Error error_;
+    template <typename U>
+    resource_allocator(const resource_allocator<U>& other) noexcept : resource_(other.resource())
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        char* block = static_cast<char*>(resource_->allocate(header_size + n * sizeof(T), alignment));
+        *reinterpret_cast<std::pmr::memory_resource**>(block) = resource_;
+        return reinterpret_cast<T*>(block + header_size);
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        char* block = reinterpret_cast<char*>(p) - header_size;
+        std::pmr::memory_resource* resource = *reinterpret_cast<std::pmr::memory_resource**>(block);
+        resource->deallocate(block, header_size + n * sizeof(T), alignment);
+    }
+
+    std::pmr::memory_resource* resource() const noexcept
+    {
+        return resource_;
+    }
+
+    template <typename U>
+    bool operator==(const resource_allocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const resource_allocator<U>&) const noexcept
+    {
+        return false;
+    }
+
+private:
+    static constexpr size_t alignment = alignof(T) > alignof(std::pmr::memory_resource*) ? alignof(T) : alignof(std::pmr::memory_resource*);
+    /// room for the resource pointer, keeping the element aligned
+    static constexpr size_t header_size = (sizeof(std::pmr::memory_resource*) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    std::pmr::memory_resource* resource_;
 };
 
 
-class ParseErrorException : public RpcEntityException
+/// nlohmann::basic_json that allocates its objects, arrays and strings from the current memory resource
+/**
+ * The characters of strings longer than the small string buffer still come from the heap,
+ * since the library reads and writes string values as std::string.
+ */
+using pmr_json = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, resource_allocator>;
+/// pmr_json that stores objects in a flat_map
+using pmr_flat_json = nlohmann::basic_json<flat_map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, resource_allocator>;
+#endif
+
+} // namespace jsonrpcpp
+
+
+/// Define JSONRPCPP_USE_FLAT_MAP to store all Json objects (e.g. named parameters) in a jsonrpcpp::flat_map
+/// Define JSONRPCPP_USE_PMR (C++17) to allocate Json values from the current memory resource (see jsonrpcpp::MemoryResourceScope)
+#if defined(JSONRPCPP_USE_PMR) && !defined(JSONRPCPP_HAS_CPP_17)
+#error "JSONRPCPP_USE_PMR requires C++17"
+#endif
+#if defined(JSONRPCPP_USE_FLAT_MAP) && defined(JSONRPCPP_USE_PMR)
+using Json = jsonrpcpp::pmr_flat_json;
+#elif defined(JSONRPCPP_USE_FLAT_MAP)
+using Json = jsonrpcpp::flat_json;
+#elif defined(JSONRPCPP_USE_PMR)
+using Json = jsonrpcpp::pmr_json;
+#else
+using Json = nlohmann::json;
+#endif
+
+namespace jsonrpcpp
+{
+
+class Entity;
+class Request;
+class Notification;
+class Parameter;
+class Response;
+class Error;
+class Batch;
+class EntityPool;
+class AnyEntity;
+class ParseResult;
+#ifdef JSONRPCPP_USE_THREADS
+class ThreadPool;
+#endif
+
+using entity_ptr = std::shared_ptr<Entity>;
+using request_ptr = std::shared_ptr<Request>;
+using notification_ptr = std::shared_ptr<Notification>;
+using parameter_ptr = std::shared_ptr<Parameter>;
+using response_ptr = std::shared_ptr<Response>;
+using error_ptr = std::shared_ptr<Error>;
+using batch_ptr = std::shared_ptr<Batch>;
+
+/// Binary encodings of JSON supported by Entity::serialize and Parser::parse_binary
+enum class binary_format_t : uint8_t
+{
+    cbor,
+    msgpack,
+    ubjson,
+    bjdata
+};
+
+
+/// Destination of the serialized text of entities (see Entity::write_to)
+/**
+ * write() receives the text in pieces, in order. The helpers serialize the
+ * parts of a message like Json::dump() does.
+ */
+class OutputBuffer
 {
 public:
-    ParseErrorException(const Error& error);
-    ParseErrorException(const std::string& data);
-    Json to_json() const override;
+    virtual ~OutputBuffer() = default;
+
+    virtual void write(const char* data, size_t size) = 0;
+    /// Write data with static storage duration, which may be referenced instead of copied
+    virtual void write_static(const char* data, size_t size);
+    /// Write the shared text, which may be referenced instead of copied
+    virtual void write_shared(const std::shared_ptr<const std::string>& text);
+    /// Serialize json, like json.dump()
+    virtual void write_json(const Json& json);
+    /// Serialize str as JSON string
+    void write_string(const std::string& str);
+
+    template <size_t N>
+    void write_literal(const char (&str)[N])
+    {
+        write_static(str, N - 1);
+    }
+
+private:
+    class Adapter;
 };
 
 
-//	-32600	Invalid Request	The JSON sent is not a valid Request object.
-//	-32601	Method not found	The method does not exist / is not available.
-//	-32602	Invalid params	Invalid method parameter(s).
-//	-32603	Internal error	Internal JSON-RPC error.
+/// OutputBuffer that appends to a std::string
+class StringBuffer : public OutputBuffer
+{
+public:
+    explicit StringBuffer(std::string& out);
 
-class RequestException : public RpcEntityException
+    void write(const char* data, size_t size) override;
+    void write_json(const Json& json) override;
+
+private:
+    std::string& out_;
+};
+
+
+/// OutputBuffer that collects the text as a list of segments for scatter-gather output (writev)
+/**
+ * Static data and shared texts (e.g. a RawJson result) of at least min_reference_size
+ * bytes are referenced, shared texts are kept alive by the buffer. Everything else is
+ * copied into chunks owned by the buffer, where consecutive copies are merged into
+ * one segment. Smaller references are copied as well, to keep the number of segments
+ * low (writev accepts at most IOV_MAX segments per call).
+ * The segments are valid until the buffer is cleared or destroyed.
+ */
+class IovecBuffer : public OutputBuffer
 {
 public:
-    RequestException(const Error& error, const Id& requestId = Id());
-    Json to_json() const override;
+    struct Segment
+    {
+        const char* data;
+        size_t size;
+    };
 
-    const Id& id() const
+    explicit IovecBuffer(size_t min_reference_size = 256, size_t chunk_size = 4096);
+
+    void write(const char* data, size_t size) override;
+    void write_static(const char* data, size_t size) override;
+    void write_shared(const std::shared_ptr<const std::string>& text) override;
+
+    const std::vector<Segment>& segments() const
     {
-        return id_;
+        return segments_;
     }
 
-protected:
-    Id id_;
+    /// Total number of bytes
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /// The concatenated segments
+    std::string str() const;
+    void clear();
+
+#ifdef JSONRPCPP_HAS_IOVEC
+    /// Append the segments to iov, e.g. for writev
+    void to_iovec(std::vector<struct iovec>& iov) const;
+#endif
+
+private:
+    void add_segment(const char* data, size_t size);
+
+    size_t min_reference_size_;
+    size_t chunk_size_;
+    std::vector<Segment> segments_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    /// free space in the last chunk
+    char* chunk_pos_;
+    size_t chunk_free_;
+    std::vector<std::shared_ptr<const std::string>> shared_;
+    size_t size_;
 };
 
 
-class InvalidRequestException : public RequestException
+class Entity
 {
 public:
-    InvalidRequestException(const Id& requestId = Id());
-    InvalidRequestException(const Request& request);
-    InvalidRequestException(const char* data, const Id& requestId = Id());
-    InvalidRequestException(const std::string& data, const Id& requestId = Id());
+    enum class entity_t : uint8_t
+    {
+        unknown,
+        exception,
+        id,
+        error,
+        response,
+        request,
+        notification,
+        batch
+    };
+
+    Entity(entity_t type);
+    virtual ~Entity() = default;
+    Entity(const Entity&) = default;
+    Entity& operator=(const Entity&) = default;
+
+    bool is_exception() const;
+    bool is_id() const;
+    bool is_error() const;
+    bool is_response() const;
+    bool is_request() const;
+    bool is_notification() const;
+    bool is_batch() const;
+
+    virtual std::string type_str() const;
+
+    virtual Json to_json() const = 0;
+    virtual void parse_json(const Json& json) = 0;
+
+    virtual void parse(const std::string& json_str);
+    virtual void parse(const char* json_str);
+    /// Parse from a buffer that is not required to be NUL-terminated
+    virtual void parse(const char* json_str, size_t size);
+#ifdef JSONRPCPP_HAS_CPP_17
+    virtual void parse(std::string_view json_str);
+#endif
+
+    /// Append the binary encoding of to_json() to out
+    void serialize(binary_format_t format, std::vector<uint8_t>& out) const;
+
+    /// Write the same text as to_json().dump(), without creating the Json
+    /**
+     * Messages write their members directly, only values like "params" and "result" are serialized as Json
+     */
+    virtual void write_to(OutputBuffer& out) const;
+    /// Append the text of write_to to out
+    void append_to(std::string& out) const;
+
+protected:
+    entity_t entity;
 };
 
 
-class MethodNotFoundException : public RequestException
+/// JSON-RPC members of a message object
+/**
+ * Non-owning view on the "jsonrpc", "id", "method", "params", "result" and "error"
+ * members of a message. A nullptr denotes a missing member.
+ * Constructed from a Json object, all members are collected in a single scan.
+ */
+struct Members
 {
-public:
-    MethodNotFoundException(const Id& requestId = Id());
-    MethodNotFoundException(const Request& request);
-    MethodNotFoundException(const char* data, const Id& requestId = Id());
-    MethodNotFoundException(const std::string& data, const Id& requestId = Id());
+    Members() = default;
+    Members(const Json& json);
+
+    /// Message type derived from the present members: request, notification, response or unknown
+    Entity::entity_t type() const;
+
+    const Json* jsonrpc = nullptr;
+    const Json* id = nullptr;
+    const Json* method = nullptr;
+    const Json* params = nullptr;
+    const Json* result = nullptr;
+    const Json* error = nullptr;
+    /// JSON text of "params" when it is not decoded (see Parameter::from_raw)
+    const char* raw_params = nullptr;
+    size_t raw_params_size = 0;
+    /// The values are owned by the producer of the Members and may be moved from
+    bool movable = false;
+
+    /// The value itself if movable, a copy otherwise
+    Json take(const Json* value) const;
+
+    /// Check the "jsonrpc" member
+    /**
+     * @return empty if it is "2.0", else the description of the problem
+     */
+    std::string check_jsonrpc() const;
 };
 
 
-class InvalidParamsException : public RequestException
+class NullableEntity : public Entity
 {
 public:
-    InvalidParamsException(const Id& requestId = Id());
-    InvalidParamsException(const Request& request);
-    InvalidParamsException(const char* data, const Id& requestId = Id());
-    InvalidParamsException(const std::string& data, const Id& requestId = Id());
+    NullableEntity(entity_t type);
+    NullableEntity(entity_t type, std::nullptr_t);
+#ifdef _MSC_VER
+    virtual operator bool() const
+#else
+    virtual explicit operator bool() const
+#endif
+    {
+        return !isNull;
+    }
+
+protected:
+    bool isNull;
 };
 
 
-class InternalErrorException : public RequestException
+/// Request id: null, a 64 bit signed or unsigned integer or a string
+/// Comparison, equality and hashing work on the stored value and do not build any Json.
+/// String ids rely on std::string's small string optimization, so short ids don't allocate.
+class Id : public Entity
 {
 public:
-    InternalErrorException(const Id& requestId = Id());
-    InternalErrorException(const Request& request);
-    InternalErrorException(const char* data, const Id& requestId = Id());
-    InternalErrorException(const std::string& data, const Id& requestId = Id());
-};
+    enum class value_t : uint8_t
+    {
+        null,
+        string,
+        integer,
+        /// unsigned integer that doesn't fit into int64_t
+        unsigned_integer
+    };
 
+    Id();
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    Id(T id) : Id()
+    {
+        if (std::is_signed<T>::value)
+            set_integer(static_cast<int64_t>(id));
+        else
+            set_unsigned(static_cast<uint64_t>(id));
+    }
+    Id(std::nullptr_t);
+    Id(const char* id);
+    Id(const std::string& id);
+    Id(std::string&& id);
+    Id(const Json& json_id);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void write_to(OutputBuffer& out) const override;
+
+    /// true if json can be an id: an integer, a string or null
+    static bool is_valid(const Json& json);
+
+    friend std::ostream& operator<<(std::ostream& out, const Id& id)
+    {
+        out << id.to_json();
+        return out;
+    }
+
+    const value_t& type() const
+    {
+        return type_;
+    }
+
+    /// @return the id as int, throws std::out_of_range if it doesn't fit, use int64_id() for 64 bit ids
+    int int_id() const
+    {
+        if (type_ == value_t::unsigned_integer)
+        {
+            if (uint64_id() > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+                throw std::out_of_range("id " + std::to_string(uint64_id()) + " does not fit into int");
+        }
+        else if ((int_id_ < std::numeric_limits<int>::min()) || (int_id_ > std::numeric_limits<int>::max()))
+            throw std::out_of_range("id " + std::to_string(int_id_) + " does not fit into int");
+        return static_cast<int>(int_id_);
+    }
+
+    int64_t int64_id() const
+    {
+        return int_id_;
+    }
+
+    uint64_t uint64_id() const
+    {
+        return static_cast<uint64_t>(int_id_);
+    }
+
+    const std::string& string_id() const
+    {
+        return string_id_;
+    }
+
+    /// Orders null < numbers < strings, like the Json representation does
+    bool operator<(const Id& other) const;
+    bool operator==(const Id& other) const;
+    bool operator!=(const Id& other) const
+    {
+        return !(*this == other);
+    }
+
+    /// @return a hash of the stored value, used by std::hash<Id>
+    size_t hash() const;
+
+protected:
+    void set_integer(int64_t id);
+    void set_unsigned(uint64_t id);
+    /// position of the type in the sort order null < integer < unsigned_integer < string
+    int rank() const;
+
+    value_t type_;
+    /// integer ids, unsigned_integer ids are stored bit-cast
+    int64_t int_id_;
+    std::string string_id_;
+};
+
+
+/// Parameters of a Request or Notification: an array, an object (map) or null
+/**
+ * Parameters created by from_raw are decoded by the first access through a const
+ * accessor, which stores the result without synchronization. Such a Parameter must
+ * not be accessed from several threads before it has been decoded, e.g. with value().
+ */
+class Parameter : public NullableEntity
+{
+public:
+    enum class value_t : uint8_t
+    {
+        null,
+        array,
+        map
+    };
+
+    Parameter(std::nullptr_t);
+    Parameter(const Json& json = nullptr);
+    Parameter(Json&& json);
+    Parameter(const std::string& key1, const Json& value1, const std::string& key2 = "", const Json& value2 = nullptr, const std::string& key3 = "",
+              const Json& value3 = nullptr, const std::string& key4 = "", const Json& value4 = nullptr);
+
+    /// Parameters that reference the JSON text json_str and are decoded on first access
+    /**
+     * The text is not copied, it must outlive the Parameter and its copies, unless
+     * detach() is called. The type (array, map or null) is known without decoding.
+     * The text is decoded on the first call to get(), has(), value(), add() or to_json(),
+     * which throw a ParseErrorException if it is not valid JSON.
+     */
+    static Parameter from_raw(const char* json_str, size_t size);
+    /// true if the JSON text json_str can be parameters, i.e. it starts an array, an object or null
+    static bool is_valid_raw(const char* json_str, size_t size);
+    /// true if json can be parameters: an array, an object or null
+    static bool is_valid(const Json& json);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void parse_json(Json&& json);
+    void write_to(OutputBuffer& out) const override;
+
+    /// The parameters as Json array, object or null, without copying them
+    const Json& value() const;
+
+    bool is_array() const;
+    bool is_map() const;
+    bool is_null() const;
+
+    /// true if the parameters are (still) kept as JSON text
+    bool is_raw() const;
+    /// The original JSON text of the parameters, empty if they were not created by from_raw()
+    std::string raw() const;
+    /// The original JSON text without copying it, nullptr if the parameters were not created by from_raw()
+    const char* raw_data() const;
+    size_t raw_size() const;
+    /// Copy the text referenced by parameters from from_raw(), so that it doesn't need to outlive them
+    void detach();
+
+    /// Named parameter, throws std::out_of_range if it doesn't exist
+    const Json& get(const std::string& key) const;
+    /// Positional parameter, throws std::out_of_range if it doesn't exist
+    const Json& get(size_t idx) const;
+    bool has(const std::string& key) const;
+    bool has(size_t idx) const;
+
+    /// Add a named parameter, null parameters are turned into a map
+    void add(const std::string& key, const Json& value);
+
+    template <typename T>
+    T get(const std::string& key) const
+    {
+        return get(key).get<T>();
+    }
+
+    template <typename T>
+    T get(size_t idx) const
+    {
+        return get(idx).get<T>();
+    }
+
+    template <typename T>
+    T get(const std::string& key, const T& default_value) const
+    {
+        if (!has(key))
+            return default_value;
+        return get<T>(key);
+    }
+
+    template <typename T>
+    T get(size_t idx, const T& default_value) const
+    {
+        if (!has(idx))
+            return default_value;
+        return get<T>(idx);
+    }
+
+    value_t type;
+
+protected:
+    void decode() const;
+
+    mutable Json value_;
+    /// text of parameters from from_raw(), nullptr after detach()
+    const char* raw_data_;
+    size_t raw_size_;
+    /// text copied by detach()
+    std::string raw_copy_;
+    mutable bool raw_pending_;
+};
+
+
+class Error : public NullableEntity
+{
+public:
+    Error(const Json& json = nullptr);
+    Error(std::nullptr_t);
+    Error(const std::string& message, int code, const Json& data = nullptr);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void write_to(OutputBuffer& out) const override;
+
+    /// Check if json is a valid error object
+    /**
+     * @return empty if parse_json accepts json, else the description of the problem
+     */
+    static std::string check_json(const Json& json);
+
+    int code() const
+    {
+        return code_;
+    }
+
+    const std::string& message() const
+    {
+        return message_;
+    }
+
+    const Json& data() const
+    {
+        return data_;
+    }
+
+protected:
+    int code_;
+    std::string message_;
+    Json data_;
+};
+
+
+/// JSON-RPC 2.0 request
+/**
+ * Simple jsonrpc 2.0 parser with getters
+ * Currently no named parameters are supported, but only array parameters
+ */
+class Request : public Entity
+{
+public:
+    Request(const Json& json = nullptr);
+    Request(const Id& id, const std::string& method, const Parameter& params = nullptr);
+
+    /// Like the constructor, but keeps the capacity of the strings (see EntityPool::make)
+    void assign(const Id& id, const std::string& method, const Parameter& params = nullptr);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void write_to(OutputBuffer& out) const override;
+    void parse_members(const Members& members);
+    /// Like parse_members, but invalid members are reported in the result instead of being thrown
+    ParseResult try_parse_members(const Members& members);
+
+    const std::string& method() const
+    {
+        return method_;
+    }
+
+    const Parameter& params() const
+    {
+        return params_;
+    }
+
+    const Id& id() const
+    {
+        return id_;
+    }
+
+protected:
+    std::string method_;
+    Parameter params_;
+    Id id_;
+};
+
+
+class RpcException : public std::exception
+{
+public:
+    RpcException(const char* text);
+    RpcException(const std::string& text);
+
+    const char* what() const noexcept override;
+
+protected:
+    std::runtime_error m_;
+};
+
+
+class RpcEntityException : public RpcException, public Entity
+{
+public:
+    RpcEntityException(const Error& error);
+    RpcEntityException(const std::string& text);
+    Json to_json() const override = 0;
+
+    const Error& error() const
+    {
+        return error_;
+    }
+
+protected:
+    void parse_json(const Json& json) override;
+    Error error_;
+};
+
+
+class ParseErrorException : public RpcEntityException
+{
+public:
+    ParseErrorException(const Error& error);
+    ParseErrorException(const std::string& data);
+    Json to_json() const override;
+    void write_to(OutputBuffer& out) const override;
+};
+
+
+//	-32600	Invalid Request	The JSON sent is not a valid Request object.
+//	-32601	Method not found	The method does not exist / is not available.
+//	-32602	Invalid params	Invalid method parameter(s).
+//	-32603	Internal error	Internal JSON-RPC error.
+
+class RequestException : public RpcEntityException
+{
+public:
+    RequestException(const Error& error, const Id& requestId = Id());
+    Json to_json() const override;
+    void write_to(OutputBuffer& out) const override;
+
+    const Id& id() const
+    {
+        return id_;
+    }
+
+protected:
+    Id id_;
+};
+
+
+class InvalidRequestException : public RequestException
+{
+public:
+    InvalidRequestException(const Id& requestId = Id());
+    InvalidRequestException(const Request& request);
+    InvalidRequestException(const char* data, const Id& requestId = Id());
+    InvalidRequestException(const std::string& data, const Id& requestId = Id());
+};
+
+
+class MethodNotFoundException : public RequestException
+{
+public:
+    MethodNotFoundException(const Id& requestId = Id());
+    MethodNotFoundException(const Request& request);
+    MethodNotFoundException(const char* data, const Id& requestId = Id());
+    MethodNotFoundException(const std::string& data, const Id& requestId = Id());
+};
+
+
+class InvalidParamsException : public RequestException
+{
+public:
+    InvalidParamsException(const Id& requestId = Id());
+    InvalidParamsException(const Request& request);
+    InvalidParamsException(const char* data, const Id& requestId = Id());
+    InvalidParamsException(const std::string& data, const Id& requestId = Id());
+};
+
+
+class InternalErrorException : public RequestException
+{
+public:
+    InternalErrorException(const Id& requestId = Id());
+    InternalErrorException(const Request& request);
+    InternalErrorException(const char* data, const Id& requestId = Id());
+    InternalErrorException(const std::string& data, const Id& requestId = Id());
+};
+
+
+/// Result of the non-throwing parse functions: the parsed entity or the error
+/**
+ * Failures are the ones the throwing functions report as exception, e.g.
+ * Parser::try_parse fails where Parser::parse throws. A failure is cheap:
+ * no exception is thrown on the way.
+ */
+class ParseResult
+{
+public:
+    /// Kind of failure, named after the exception of the throwing functions
+    enum class error_t : uint8_t
+    {
+        none,
+        /// ParseErrorException: the text is not valid JSON
+        parse_error,
+        /// RequestException: invalid request, error() and id() describe the error response
+        request_error,
+        /// RpcException: invalid notification or response, the description is error().message()
+        rpc_error
+    };
+
+    /// Success, entity is nullptr if the text is neither a message nor a batch
+    ParseResult(entity_ptr entity = nullptr);
+    ParseResult(const ParseErrorException& exception);
+    ParseResult(const RequestException& exception);
+    ParseResult(const RpcException& exception);
+
+    bool has_value() const
+    {
+        return kind_ == error_t::none;
+    }
+
+    explicit operator bool() const
+    {
+        return has_value();
+    }
+
+    error_t kind() const
+    {
+        return kind_;
+    }
+
+    const entity_ptr& entity() const
+    {
+        return entity_;
+    }
+
+    /// The JSON-RPC error, for rpc_error with code -32600 (Invalid Request)
+    const Error& error() const
+    {
+        return error_;
+    }
+
+    int code() const
+    {
+        return error_.code();
+    }
+
+    /// Id of the failed request, null if it is unknown
+    const Id& id() const
+    {
+        return id_;
+    }
+
+    /// The entity, or throw the exception that the throwing functions throw
+    entity_ptr value_or_throw() const;
+    /// Throw the exception that the throwing functions throw, must only be called on failure
+    [[noreturn]] void throw_error() const;
+
+private:
+    error_t kind_;
+    entity_ptr entity_;
+    Error error_;
+    Id id_;
+};
+
+
+/// JSON text that is already serialized, e.g. a cached result
+/**
+ * The text is shared, not copied, by the Responses created from it, and
+ * written verbatim by Response::write_to. It is only parsed if the result is
+ * accessed as Json.
+ * The text may contain whitespace, including newlines (see NdjsonCodec::encode).
+ */
+class RawJson
+{
+public:
+    /// Throws a ParseErrorException if json_str is not valid JSON
+    explicit RawJson(std::string json_str);
+    explicit RawJson(std::shared_ptr<const std::string> json_str);
+
+    /// Raw JSON that is not validated, json_str must be valid JSON, e.g. because it was serialized by a Json
+    static RawJson trusted(std::string json_str);
+    static RawJson trusted(std::shared_ptr<const std::string> json_str);
+
+    const std::string& str() const
+    {
+        return *json_str_;
+    }
+
+    const std::shared_ptr<const std::string>& ptr() const
+    {
+        return json_str_;
+    }
+
+    /// true if the text is valid JSON, checked without parsing it into a Json
+    bool is_valid() const;
+    /// Parse the text, throws a ParseErrorException if it is not valid JSON
+    Json parse() const;
+
+private:
+    struct trusted_t
+    {
+    };
+
+    RawJson(std::shared_ptr<const std::string> json_str, trusted_t);
+
+    std::shared_ptr<const std::string> json_str_;
+};
+
+
+class Response : public Entity
+{
+public:
+    Response(const Json& json = nullptr);
+    Response(const Id& id, const Json& result);
+    /// Response with a result that is written verbatim by write_to
+    Response(const Id& id, const RawJson& result);
+    Response(const Id& id, const Error& error);
+    Response(const Request& request, const Json& result);
+    Response(const Request& request, const RawJson& result);
+    Response(const Request& request, const Error& error);
+    Response(const RequestException& exception);
+
+    /// Like the constructors, but keep the capacity of the strings (see EntityPool::make)
+    void assign(const Id& id, const Json& result);
+    void assign(const Id& id, const RawJson& result);
+    void assign(const Id& id, const Error& error);
+    void assign(const Request& request, const Json& result);
+    void assign(const Request& request, const RawJson& result);
+    void assign(const Request& request, const Error& error);
+    void assign(const RequestException& exception);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void write_to(OutputBuffer& out) const override;
+    void parse_members(const Members& members);
+    /// Like parse_members, but invalid members are reported in the result instead of being thrown
+    ParseResult try_parse_members(const Members& members);
+
+    const Id& id() const
+    {
+        return id_;
+    }
+
+    /// The result, a raw result is parsed on the first call
+    const Json& result() const;
+
+    /// The text of a raw result, nullptr if the result is not raw
+    const std::string* raw_result() const
+    {
+        return raw_result_ ? raw_result_.get() : nullptr;
+    }
+
+    const Error& error() const
+    {
+        return error_;
+    }
+
+protected:
+    Id id_;
+    mutable Json result_;
+    Error error_;
+    std::shared_ptr<const std::string> raw_result_;
+    /// raw_result_ has not been parsed into result_ yet
+    mutable bool raw_pending_ = false;
+};
+
+
+class Notification : public Entity
+{
+public:
+    Notification(const Json& json = nullptr);
+    Notification(const char* method, const Parameter& params = nullptr);
+    Notification(const std::string& method, const Parameter& params);
+
+    /// Like the constructor, but keeps the capacity of the method (see EntityPool::make)
+    void assign(const std::string& method, const Parameter& params = nullptr);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void write_to(OutputBuffer& out) const override;
+    void parse_members(const Members& members);
+    /// Like parse_members, but invalid members are reported in the result instead of being thrown
+    ParseResult try_parse_members(const Members& members);
+
+    const std::string& method() const
+    {
+        return method_;
+    }
+
+    const Parameter& params() const
+    {
+        return params_;
+    }
+
+protected:
+    std::string method_;
+    Parameter params_;
+};
+
+
+/// Create an entity like std::make_shared
+/**
+ * In C++17 the entity and its control block are allocated from the resource
+ * of the active MemoryResourceScope, if there is one
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> make_entity(Args&&... args)
+{
+#ifdef JSONRPCPP_HAS_CPP_17
+    if (MemoryResourceScope::active() != nullptr)
+        return std::allocate_shared<T>(resource_allocator<T>(), std::forward<Args>(args)...);
+#endif
+    return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+/// Create an entity whose memory, including the control block and Json values if Json is pmr_json, comes from resource
+/**
+ * resource must outlive the entity
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> allocate_entity(std::pmr::memory_resource* resource, Args&&... args)
+{
+    MemoryResourceScope scope(resource);
+    return std::allocate_shared<T>(resource_allocator<T>(), std::forward<Args>(args)...);
+}
+#endif
+
+
+typedef std::function<void(const Parameter& params)> notification_callback;
+typedef std::function<jsonrpcpp::response_ptr(const Id& id, const Parameter& params)> request_callback;
+typedef std::function<void(const entity_ptr& entity)> element_callback;
+typedef std::function<void(const entity_ptr& entity, bool batch_element)> streaming_callback;
+
+
+/// Bounds on the work done for one message, enforced while parsing (see Parser::set_limits)
+/**
+ * Parsing stops at the first violation, the message fails with an
+ * InvalidRequestException (-32600) that names the exceeded limit in its data.
+ * All limits are unbounded by default.
+ */
+struct ParserLimits
+{
+    /// Size of the text in bytes
+    size_t max_size = std::numeric_limits<size_t>::max();
+    /// Nesting depth of arrays and objects, a message object or a batch has depth 1
+    size_t max_depth = std::numeric_limits<size_t>::max();
+    /// Number of elements of a batch
+    size_t max_batch_size = std::numeric_limits<size_t>::max();
+    /// Length of strings and object keys in bytes
+    size_t max_string_length = std::numeric_limits<size_t>::max();
+    /// Number of elements of an array or members of an object, other than a batch
+    size_t max_array_size = std::numeric_limits<size_t>::max();
+};
+
+
+/// Expected parameters of a method, checked by the Parser before the request callback is invoked
+/**
+ * Each parameter has a name and a position, so the schema checks named (map) as well
+ * as positional (array) parameters. A parameter matches if its value has the declared
+ * type. Parameters that are not in the schema are accepted, unless the schema is strict.
+ * The check runs when the parsed request is dispatched, not while it is parsed: a
+ * request with mismatching parameters has been parsed and its parameters copied
+ * into the Request before it is rejected, so the schema doesn't save that cost.
+ */
+class ParamSchema
+{
+public:
+    enum class type_t : uint8_t
+    {
+        any,
+        null,
+        boolean,
+        integer,
+        number,
+        string,
+        array,
+        object
+    };
+
+    ParamSchema() = default;
+
+    /// Add a required parameter at the next position
+    ParamSchema& required(const std::string& name, type_t type = type_t::any);
+    /// Add an optional parameter at the next position
+    ParamSchema& optional(const std::string& name, type_t type = type_t::any);
+    /// Reject parameters that are not in the schema
+    ParamSchema& strict(bool strict = true);
+
+    /// Check params against the schema
+    /**
+     * @return empty if the parameters match, else the description of the first mismatch
+     */
+    std::string check(const Parameter& params) const;
+    std::string check(const Json& params) const;
+
+    static bool matches(type_t type, const Json& value);
+    static std::string type_str(type_t type);
+
+private:
+    struct Param
+    {
+        std::string name;
+        type_t type;
+        bool required;
+    };
+
+    std::string check_value(const Param& param, const Json& value) const;
+
+    std::vector<Param> params_;
+    bool strict_ = false;
+};
+
+
+class Parser
+{
+public:
+    Parser() = default;
+    virtual ~Parser() = default;
+
+    entity_ptr parse(const std::string& json_str);
+    entity_ptr parse(const char* json_str);
+    /// Parse from a buffer that is not required to be NUL-terminated
+    virtual entity_ptr parse(const char* json_str, size_t size);
+#ifdef JSONRPCPP_HAS_CPP_17
+    entity_ptr parse(std::string_view json_str);
+    /// Parse and invoke the callbacks with resource as the current memory resource (see MemoryResourceScope)
+    /**
+     * Handlers get the resource from current_memory_resource() for their own allocations.
+     * resource must outlive the returned entity.
+     */
+    entity_ptr parse(const char* json_str, size_t size, std::pmr::memory_resource* resource);
+#endif
+    entity_ptr parse_json(const Json& json);
+    /// Parse and invoke the callbacks, failures are reported in the result instead of being thrown
+    /**
+     * Parses with the SAX parser of nlohmann_traits (see do_try_parse), or with do_parse_lazy if lazy
+     * parameters are set and there are no limits.
+     * A RequestException thrown by a request callback or for a ParamSchema mismatch is reported in the result,
+     * as is a ParseErrorException for invalid lazy parameters that are decoded by a callback.
+     */
+    ParseResult try_parse(const std::string& json_str);
+    ParseResult try_parse(const char* json_str, size_t size);
+    /// Parse and dispatch the elements of a batch one by one, while the text is being parsed
+    /**
+     * callback is invoked for each batch element as soon as it is complete, with what parse
+     * would return for it: the response of a request callback, else the element itself,
+     * or the Error or RequestException of an invalid element. A RequestException thrown by
+     * a request callback is passed as element as well. A single message is passed to callback
+     * in the same way, with batch_element false. The elements are not collected in a Batch,
+     * so the memory used is bounded by the largest element.
+     * Failures of the whole text are reported in the result. The elements before a parse error
+     * have been passed to callback already.
+     */
+    ParseResult parse_streaming(const std::string& json_str, const streaming_callback& callback);
+    ParseResult parse_streaming(const char* json_str, size_t size, const streaming_callback& callback);
+    /// Parse into an AnyEntity and invoke the callbacks, see do_parse_any
+    AnyEntity parse_any(const std::string& json_str);
+    AnyEntity parse_any(const char* json_str, size_t size);
+    /// Parse a binary encoded message (see Entity::serialize) and invoke the callbacks
+    entity_ptr parse_binary(const std::vector<uint8_t>& buffer, binary_format_t format);
+    entity_ptr parse_binary(const uint8_t* data, size_t size, binary_format_t format);
+
+    void register_notification_callback(const std::string& notification, notification_callback callback);
+    void register_request_callback(const std::string& request, request_callback callback);
+    /// Register a request callback that is only invoked if the parameters match schema
+    /**
+     * Requests with mismatching parameters fail with an InvalidParamsException (-32602),
+     * which carries the description of the mismatch as data.
+     */
+    void register_request_callback(const std::string& request, request_callback callback, ParamSchema schema);
+
+    /// Keep the "params" of parsed messages as JSON text until they are accessed (see do_parse_lazy)
+    /**
+     * The parameters of the entities returned by parse and try_parse then reference the
+     * parsed text (see Parameter::from_raw)
+     */
+    void set_lazy_params(bool lazy);
+
+    /// Create parsed entities from pool (see EntityPool), nullptr to allocate new ones
+    void set_entity_pool(std::shared_ptr<EntityPool> pool);
+
+    /// Enforce limits while parsing with parse, try_parse, parse_streaming, parse_any and parse_binary
+    /**
+     * With limits, parse uses the SAX parser of nlohmann_traits, also if lazy parameters are set
+     * or the parser is a BasicParser with another backend
+     */
+    void set_limits(const ParserLimits& limits);
+
+    static entity_ptr do_parse(const std::string& json_str);
+    static entity_ptr do_parse(const char* json_str);
+    static entity_ptr do_parse(const char* json_str, size_t size);
+    /// Parse with the SAX parser of nlohmann_traits, enforcing limits
+    static entity_ptr do_parse(const char* json_str, size_t size, const ParserLimits& limits);
+    /// Parse with the JSON backend Traits (see nlohmann_traits), do_parse uses default_json_traits
+    template <typename Traits>
+    static entity_ptr do_parse_with(const char* json_str, size_t size);
+    static entity_ptr do_parse_json(const Json& json);
+    static entity_ptr do_parse_members(const Members& members);
+    /// Non-throwing versions of do_parse and do_parse_members
+    /**
+     * Invalid text and invalid messages are reported in the result, invalid batch
+     * elements are part of the batch like with do_parse.
+     * The text is parsed with the SAX parser of nlohmann_traits.
+     */
+    static ParseResult do_try_parse(const std::string& json_str);
+    static ParseResult do_try_parse(const char* json_str, size_t size, const ParserLimits& limits = ParserLimits());
+    static ParseResult do_try_parse_members(const Members& members);
+    /// Parse into an AnyEntity, without heap allocating the entity
+    /**
+     * The text is parsed with the SAX parser of nlohmann_traits. Errors are reported like do_parse does.
+     */
+    static AnyEntity do_parse_any(const std::string& json_str);
+    static AnyEntity do_parse_any(const char* json_str, size_t size, const ParserLimits& limits = ParserLimits());
+    /// Parse without decoding "params", which are stored as JSON text in the Parameter
+    /**
+     * The text of "params" and of unknown members is only checked for its structure,
+     * invalid JSON inside is reported when the parameters are accessed.
+     * The parameters reference json_str without copying it, so json_str must outlive
+     * them, unless they are detached (see Parameter::detach).
+     */
+    static entity_ptr do_parse_lazy(const char* json_str, size_t size);
+    /// Parse a binary encoded message
+    /**
+     * The data is decoded with the SAX parser of nlohmann json, the entities are created
+     * without building a Json document of the whole message. Errors are reported like do_parse does.
+     */
+    static entity_ptr do_parse_binary(const std::vector<uint8_t>& buffer, binary_format_t format);
+    static entity_ptr do_parse_binary(const uint8_t* data, size_t size, binary_format_t format, const ParserLimits& limits = ParserLimits());
+#ifdef JSONRPCPP_USE_THREADS
+    /// Parse the elements of a batch on the worker threads of pool and on the calling thread
+    /**
+     * The element boundaries are found in one structural pass over the text, the elements
+     * are then parsed in parallel and the Batch is assembled in the original order.
+     * Small batches and single messages are parsed on the calling thread.
+     * The worker threads don't use the EntityPoolScope and MemoryResourceScope of the
+     * calling thread, their elements are allocated with new.
+     * Must not be called from a task running on pool.
+     */
+    static entity_ptr do_parse_parallel(const char* json_str, size_t size, ThreadPool& pool);
+    static entity_ptr do_parse_parallel(const std::string& json_str, ThreadPool& pool);
+#endif
+    static bool is_request(const std::string& json_str);
+    static bool is_request(const char* json_str, size_t size);
+    static bool is_request(const Json& json);
+    static bool is_notification(const std::string& json_str);
+    static bool is_notification(const char* json_str, size_t size);
+    static bool is_notification(const Json& json);
+    static bool is_response(const std::string& json_str);
+    static bool is_response(const char* json_str, size_t size);
+    static bool is_response(const Json& json);
+    static bool is_batch(const std::string& json_str);
+    static bool is_batch(const char* json_str, size_t size);
+    static bool is_batch(const Json& json);
+#ifdef JSONRPCPP_HAS_CPP_17
+    static entity_ptr do_parse(std::string_view json_str);
+    /// Parse with resource as the current memory resource, which must outlive the returned entity
+    static entity_ptr do_parse(const char* json_str, size_t size, std::pmr::memory_resource* resource);
+    static bool is_request(std::string_view json_str);
+    static bool is_notification(std::string_view json_str);
+    static bool is_response(std::string_view json_str);
+    static bool is_batch(std::string_view json_str);
+#endif
+
+protected:
+    /// Invoke the callback registered for a parsed request or notification
+    /**
+     * @return the response of a request callback, else the entity itself
+     */
+    entity_ptr dispatch(const entity_ptr& entity);
+    AnyEntity dispatch(AnyEntity&& entity);
+    /// dispatch for a batch element, a thrown RequestException is returned as entity
+    entity_ptr dispatch_element(const entity_ptr& entity);
+    template <typename T>
+    static ParseResult try_parse_entity(const Members& members);
+    void dispatch_notification(const Notification& notification);
+    response_ptr dispatch_request(const Request& request);
+
+    std::map<std::string, notification_callback> notification_callbacks_;
+    std::map<std::string, request_callback> request_callbacks_;
+    std::map<std::string, ParamSchema> param_schemas_;
+    bool lazy_params_ = false;
+    std::shared_ptr<EntityPool> entity_pool_;
+    bool limited_ = false;
+    ParserLimits limits_;
+};
+
+
+class Batch : public Entity
+{
+public:
+    std::vector<entity_ptr> entities;
+
+    Batch(const Json& json = nullptr);
+
+    Json to_json() const override;
+    void parse_json(const Json& json) override;
+    void write_to(OutputBuffer& out) const override;
+
+    template <typename T>
+    void add(const T& entity)
+    {
+        entities.push_back(make_entity<T>(entity));
+    }
+
+    void add_ptr(const entity_ptr& entity)
+    {
+        entities.push_back(entity);
+    }
+
+    /// Parse a single batch element
+    /**
+     * Invalid elements do not fail the batch, but are returned as Error or RequestException
+     * @param parse callable returning the parsed entity_ptr
+     */
+    template <typename Parse>
+    static entity_ptr parse_element(const Parse& parse);
+
+    /// Batch element for a parse result: the entity, or the Error or RequestException for the failure
+    static entity_ptr to_element(const ParseResult& result);
+};
+
+
+/// Entity by value: empty, or a Request, Notification, Response, Batch, Error or RequestException
+/**
+ * A tagged union that spares the heap allocation of an entity_ptr and the
+ * dynamic_pointer_cast to the concrete type. type() tells the alternative, the
+ * as_...() accessors don't check it. visit() calls a visitor with the alternative.
+ * Exceptions derived from RequestException are stored as RequestException.
+ */
+class AnyEntity
+{
+public:
+    AnyEntity();
+    AnyEntity(Request request);
+    AnyEntity(Notification notification);
+    AnyEntity(Response response);
+    AnyEntity(Batch batch);
+    AnyEntity(Error error);
+    AnyEntity(RequestException exception);
+    AnyEntity(const AnyEntity& other);
+    AnyEntity(AnyEntity&& other) noexcept;
+    AnyEntity& operator=(const AnyEntity& other);
+    AnyEntity& operator=(AnyEntity&& other) noexcept;
+    ~AnyEntity();
+
+    /// Request, notification or response described by members, like Parser::do_parse_members
+    static AnyEntity from_members(const Members& members);
+
+    /// Type of the alternative: request, notification, response, batch, error, exception or unknown if empty
+    Entity::entity_t type() const
+    {
+        return type_;
+    }
+
+    bool empty() const
+    {
+        return type_ == Entity::entity_t::unknown;
+    }
+
+    explicit operator bool() const
+    {
+        return !empty();
+    }
+
+    bool is_request() const
+    {
+        return type_ == Entity::entity_t::request;
+    }
+
+    bool is_notification() const
+    {
+        return type_ == Entity::entity_t::notification;
+    }
+
+    bool is_response() const
+    {
+        return type_ == Entity::entity_t::response;
+    }
+
+    bool is_batch() const
+    {
+        return type_ == Entity::entity_t::batch;
+    }
+
+    bool is_error() const
+    {
+        return type_ == Entity::entity_t::error;
+    }
+
+    bool is_exception() const
+    {
+        return type_ == Entity::entity_t::exception;
+    }
+
+    Request& as_request()
+    {
+        return request_;
+    }
+
+    const Request& as_request() const
+    {
+        return request_;
+    }
+
+    Notification& as_notification()
+    {
+        return notification_;
+    }
+
+    const Notification& as_notification() const
+    {
+        return notification_;
+    }
+
+    Response& as_response()
+    {
+        return response_;
+    }
+
+    const Response& as_response() const
+    {
+        return response_;
+    }
+
+    Batch& as_batch()
+    {
+        return batch_;
+    }
+
+    const Batch& as_batch() const
+    {
+        return batch_;
+    }
+
+    Error& as_error()
+    {
+        return error_;
+    }
+
+    const Error& as_error() const
+    {
+        return error_;
+    }
+
+    RequestException& as_exception()
+    {
+        return exception_;
+    }
+
+    const RequestException& as_exception() const
+    {
+        return exception_;
+    }
+
+    /// The alternative as Entity, nullptr if empty
+    Entity* get();
+    const Entity* get() const;
+
+    /// @return the Json of the alternative, null if empty
+    Json to_json() const;
+    /// @return a copy of the alternative as entity_ptr, nullptr if empty
+    entity_ptr to_ptr() const;
+
+    /// Call visitor with the alternative
+    /**
+     * The visitor must accept all alternatives and return the same type for them.
+     * An empty AnyEntity is not visited, a value initialized result is returned.
+     */
+    template <typename Visitor>
+    auto visit(Visitor&& visitor) -> decltype(visitor(std::declval<Request&>()))
+    {
+        switch (type_)
+        {
+            case Entity::entity_t::request:
+                return visitor(request_);
+            case Entity::entity_t::notification:
+                return visitor(notification_);
+            case Entity::entity_t::response:
+                return visitor(response_);
+            case Entity::entity_t::batch:
+                return visitor(batch_);
+            case Entity::entity_t::error:
+                return visitor(error_);
+            case Entity::entity_t::exception:
+                return visitor(exception_);
+            default:
+                break;
+        }
+        return decltype(visitor(std::declval<Request&>()))();
+    }
+
+    template <typename Visitor>
+    auto visit(Visitor&& visitor) const -> decltype(visitor(std::declval<const Request&>()))
+    {
+        switch (type_)
+        {
+            case Entity::entity_t::request:
+                return visitor(request_);
+            case Entity::entity_t::notification:
+                return visitor(notification_);
+            case Entity::entity_t::response:
+                return visitor(response_);
+            case Entity::entity_t::batch:
+                return visitor(batch_);
+            case Entity::entity_t::error:
+                return visitor(error_);
+            case Entity::entity_t::exception:
+                return visitor(exception_);
+            default:
+                break;
+        }
+        return decltype(visitor(std::declval<const Request&>()))();
+    }
+
+private:
+    void copy_from(const AnyEntity& other);
+    void move_from(AnyEntity& other);
+    void destroy();
+
+    Entity::entity_t type_;
+    union
+    {
+        Request request_;
+        Notification notification_;
+        Response response_;
+        Batch batch_;
+        Error error_;
+        RequestException exception_;
+    };
+};
+
+
+/// Pool of reusable Request, Notification, Response and Batch objects
+/**
+ * An object is handed out again once the pool holds the last reference to it,
+ * i.e. all entity_ptrs to it have been released. Recycled objects keep the
+ * capacity of their strings and vectors, so steady-state parsing allocates
+ * hardly anything besides the Json values of the messages.
+ * While an EntityPoolScope is active, the Parser takes its entities from the pool.
+ * A pool must only be used by one thread at a time, and the entities it hands
+ * out must be released on that thread. Entities from a pool must not be allocated
+ * from a MemoryResourceScope's resource that is released before the pool.
+ */
+class EntityPool
+{
+public:
+    /// @param max_size maximum number of objects per type that are kept for reuse
+    explicit EntityPool(size_t max_size = 64);
+
+    /// An unused object of type T, in the state it was left in (Batch::entities is cleared)
+    /**
+     * The object must be reinitialized, e.g. with parse_json
+     */
+    template <typename T>
+    std::shared_ptr<T> get();
+
+    /// An unused object of type T, initialized like T(args...)
+    /**
+     * The object is initialized in place with T::assign(args...) if there is such an
+     * overload, keeping the capacity of its strings and vectors, else it is assigned T(args...)
+     */
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make(Args&&... args);
+
+    /// Number of objects held by the pool, in use or not
+    size_t size() const;
+
+    /// An object from the pool of the active EntityPoolScope, a new one if there is none
+    template <typename T>
+    static std::shared_ptr<T> acquire();
+
+    /// The pool of the innermost EntityPoolScope of this thread, nullptr outside of any scope
+    static EntityPool*& active();
+
+private:
+    template <typename T>
+    struct Slots
+    {
+        std::vector<std::shared_ptr<T>> items;
+        size_t next = 0;
+    };
+
+    template <typename T>
+    std::shared_ptr<T> get(Slots<T>& slots);
+
+    template <typename T, typename... Args>
+    static auto assign(T& entity, int, Args&&... args) -> decltype(entity.assign(std::forward<Args>(args)...), void());
+    template <typename T, typename... Args>
+    static void assign(T& entity, long, Args&&... args);
+
+    Slots<Request> requests_;
+    Slots<Notification> notifications_;
+    Slots<Response> responses_;
+    Slots<Batch> batches_;
+    size_t max_size_;
+};
+
+
+/// Makes an EntityPool the active pool of the thread while it exists, nullptr disables pooling
+class EntityPoolScope
+{
+public:
+    explicit EntityPoolScope(EntityPool* pool);
+    ~EntityPoolScope();
+
+    EntityPoolScope(const EntityPoolScope&) = delete;
+    EntityPoolScope& operator=(const EntityPoolScope&) = delete;
+
+private:
+    EntityPool* previous_;
+};
+
+
+/// Structural scanner for JSON text
+/**
+ * Finds the extent of JSON values without decoding them. Only the structure
+ * (strings, nesting of objects and arrays) is checked, scalars are not validated.
+ * Errors are reported as ParseErrorException.
+ */
+class JsonScanner
+{
+public:
+    JsonScanner(const char* first, const char* last);
+
+    /// Skip whitespace and return the next character without consuming it, '\0' at the end
+    char peek();
+    /// Skip whitespace and consume the next character, which must be c
+    void expect(char c);
+    /// Skip whitespace and consume the next character if it is c
+    bool consume(char c);
+    /// Skip whitespace, true if the end of the input is reached
+    bool at_end();
+    /// Skip the value at the current position and return its beginning
+    const char* skip_value();
+    /// Read the string at the current position, escape sequences are decoded
+    std::string read_string();
+
+    const char* position() const
+    {
+        return pos_;
+    }
+
+    [[noreturn]] void error() const;
+
+private:
+    void skip_whitespace();
+    void skip_string();
+
+    const char* first_;
+    const char* pos_;
+    const char* last_;
+};
+
+
+/// Parser behind Parser::do_parse_lazy
+/**
+ * Scans the message envelope with a JsonScanner, decodes the values of known
+ * members and keeps the text of "params" in the Parameter.
+ */
+class LazyParser
+{
+public:
+    static entity_ptr parse(const char* json_str, size_t size);
+
+private:
+    struct Message
+    {
+        enum member_t : uint8_t
+        {
+            jsonrpc,
+            id,
+            method,
+            result,
+            error,
+            member_count
+        };
+
+        Members members() const;
+
+        Json values[member_count];
+        bool present[member_count];
+        const char* params;
+        size_t params_size;
+    };
+
+    static void read_message(JsonScanner& scanner, Message& message);
+};
+
+
+#ifdef JSONRPCPP_USE_THREADS
+/// Fixed set of worker threads that run posted tasks, e.g. for Parser::do_parse_parallel
+/**
+ * The threads are started by the constructor and reused for all tasks. The
+ * destructor finishes the queued tasks and joins the threads.
+ */
+class ThreadPool
+{
+public:
+    /// @param threads number of worker threads, 0 for one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Number of worker threads
+    size_t size() const
+    {
+        return workers_.size();
+    }
+
+    /// Run task on one of the worker threads, task must not throw
+    void post(std::function<void()> task);
+
+private:
+    void run();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopped_;
+};
+
+
+/// Parser behind Parser::do_parse_parallel
+/**
+ * Finds the begin and end of each batch element with a JsonScanner and parses
+ * consecutive ranges of elements on the threads of a ThreadPool.
+ */
+class ParallelParser
+{
+public:
+    static entity_ptr parse(const char* json_str, size_t size, ThreadPool& pool);
+
+private:
+    struct Element
+    {
+        const char* begin;
+        const char* end;
+    };
+
+    /// Minimal number of elements parsed by one thread
+    static const size_t min_elements = 64;
+
+    static entity_ptr parse_element(const Element& element);
+    static void parse_range(const Element* first, const Element* last, entity_ptr* out);
+};
+#endif
+
+
+#ifdef JSONRPCPP_USE_SIMDJSON
+/// Parser behind simdjson_traits, the default backend when built with JSONRPCPP_USE_SIMDJSON
+/**
+ * Parses the text with simdjson's On-Demand API and fills the Members of each
+ * message from it. Only the values of known members are converted to Json,
+ * unknown members are validated without being converted.
+ * simdjson reads up to SIMDJSON_PADDING bytes behind the text, so the text is
+ * copied into a buffer of the thread that is reused for every message.
+ */
+class SimdjsonParser
+{
+public:
+    static entity_ptr parse(const char* json_str, size_t size);
+    /// Parse in place, without copying the text, if capacity >= size + SIMDJSON_PADDING
+    /**
+     * @param capacity number of readable bytes at json_str, including the padding behind the text
+     */
+    static entity_ptr parse(const char* json_str, size_t size, size_t capacity);
+
+private:
+    struct Message
+    {
+        enum member_t : uint8_t
+        {
+            jsonrpc,
+            id,
+            method,
+            params,
+            result,
+            error,
+            member_count
+        };
+
+        Members members() const;
+
+        Json values[member_count];
+        bool present[member_count];
+    };
+
+    static void read_message(simdjson::ondemand::object object, Message& message);
+    static Json to_json(simdjson::ondemand::value value);
+    /// Validate value, like to_json but without converting it
+    static void check(simdjson::ondemand::value value);
+};
+#endif
+
+
+/// SAX handler that parses entities in a single pass over the JSON text
+/**
+ * Instead of building a Json DOM of the whole message, the JSON-RPC members of
+ * message objects are collected while parsing. Only the values of known members
+ * ("id", "params", "result", ...) are materialized, unknown members are skipped.
+ * Elements of a batch are turned into entities as soon as they are complete.
+ * The entity is created by entity(), after the whole text has been parsed.
+ */
+class EntitySaxHandler
+{
+public:
+    EntitySaxHandler();
+
+    bool null();
+    bool boolean(bool val);
+    bool number_integer(Json::number_integer_t val);
+    bool number_unsigned(Json::number_unsigned_t val);
+    bool number_float(Json::number_float_t val, const Json::string_t& s);
+    bool string(Json::string_t& val);
+    bool binary(Json::binary_t& val);
+    bool start_object(std::size_t elements);
+    bool key(Json::string_t& val);
+    bool end_object();
+    bool start_array(std::size_t elements);
+    bool end_array();
+    bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex);
+
+    /// The parsed entity, nullptr if the text is neither a message nor a batch
+    entity_ptr entity();
+    /// Like entity(), but failures are reported in the result instead of being thrown
+    ParseResult parse_result();
+
+    /// Pass batch elements to callback as soon as they are complete, instead of collecting them
+    /**
+     * entity() and parse_result() return nullptr for a batch then
+     */
+    void set_element_callback(element_callback callback);
+    /// The parsed entity by value, empty if the text is neither a message nor a batch
+    AnyEntity any_entity();
+
+    /// Fail with an InvalidRequestException when the text exceeds limits
+    void set_limits(const ParserLimits& limits);
+    /// Check the size of the text against the limits before parsing it
+    /**
+     * @return false if it is too large, parse_result() reports the failure then
+     */
+    bool check_size(size_t size);
+
+private:
+    enum class state_t : uint8_t
+    {
+        document,
+        member_key,
+        member_value,
+        batch_element,
+        done,
+        /// the text is not valid JSON, see parse_error_
+        failed,
+        /// a ParserLimits is exceeded, see parse_error_
+        limit_exceeded
+    };
+
+    enum member_t : uint8_t
+    {
+        jsonrpc,
+        id,
+        method,
+        params,
+        result,
+        error,
+        member_count
+    };
+
+    void begin_message();
+    Members members() const;
+    void value_done();
+    void add_element(const entity_ptr& element);
+    bool add_value(Json&& value);
+    bool start_container(Json&& container);
+    bool end_container();
+    /// Account for a value in the enclosing container and for an opened container
+    bool count_value();
+    bool enter_container();
+    void leave_container();
+    bool check_string(const Json::string_t& val);
+    bool exceeded(const std::string& limit);
+
+    state_t state_;
+    bool in_batch_;
+    /// values of the members of the current message
+    Json values_[member_count];
+    bool present_[member_count];
+    /// target of the current member value, nullptr if the member is skipped
+    Json* target_;
+    /// nesting level inside a skipped member value
+    size_t skip_depth_;
+    /// containers of the value that is currently materialized
+    std::vector<Json*> stack_;
+    Json* object_element_;
+    Json element_;
+    batch_ptr batch_;
+    size_t batch_size_;
+    element_callback element_callback_;
+    std::string parse_error_;
+    ParserLimits limits_;
+    /// number of values in each open array and object
+    std::vector<size_t> sizes_;
+};
+
+
+// JSON backends
+//
+// A traits type plugs a JSON library into the Parser. It provides
+//   static entity_ptr parse(const char* json_str, size_t size);
+// which reads the JSON text and creates the entity, usually by collecting the
+// members of each message into Members and passing them to Parser::do_parse_members,
+// or by passing a Json to Parser::do_parse_json. Malformed text is reported by
+// throwing any exception, Parser::do_parse_with turns it into a ParseErrorException.
+// Entities keep their values as Json, so a backend only replaces the parsing of
+// the text. The backend of a Parser is selected with BasicParser<Traits>.
+/// nlohmann SAX parser, the default backend (see EntitySaxHandler)
+struct nlohmann_traits
+{
+    static entity_ptr parse(const char* json_str, size_t size);
+};
+
+#ifdef JSONRPCPP_USE_SIMDJSON
+/// simdjson On-Demand parser (see SimdjsonParser)
+struct simdjson_traits
+{
+    static entity_ptr parse(const char* json_str, size_t size);
+};
+
+using default_json_traits = simdjson_traits;
+#else
+using default_json_traits = nlohmann_traits;
+#endif
+
+
+/// Parser that reads message text with the JSON backend Traits
+template <typename Traits>
+class BasicParser : public Parser
+{
+public:
+    using Parser::parse;
+
+    entity_ptr parse(const char* json_str, size_t size) override
+    {
+        EntityPoolScope scope(entity_pool_.get());
+        if (limited_)
+            return dispatch(do_parse(json_str, size, limits_));
+        return dispatch(lazy_params_ ? do_parse_lazy(json_str, size) : do_parse_with<Traits>(json_str, size));
+    }
+};
+
+
+/// Incremental decoder for a stream of JSON-RPC messages, e.g. read from a socket
+/**
+ * The stream is fed in chunks of any size. The structure of the messages
+ * (nesting and strings) is tracked across chunks, so the buffered beginning of a
+ * message is not searched again when the next chunk arrives, and each message is
+ * parsed as soon as its closing bracket arrives. The parser itself does not
+ * resume across chunks: every byte is examined twice, once to find the end of
+ * its message and once when the complete message is parsed.
+ * Messages that are complete within a chunk are parsed in place, only the
+ * beginning of an incomplete message is buffered.
+ * Messages are objects or arrays, separated by optional whitespace. Any other
+ * character between messages is reported as ParseErrorException and skipped.
+ * A message larger than max_size is reported as ParseErrorException and skipped
+ * without being buffered.
+ */
+class StreamDecoder
+{
+public:
+    typedef std::function<void(const ParseResult& result)> result_callback;
+
+    /// Parse messages with Parser::do_try_parse
+    /// @param max_size maximum size of a message in bytes
+    explicit StreamDecoder(result_callback callback, size_t max_size = 16 * 1024 * 1024);
+    /// Parse messages with parser.try_parse, i.e. with the parser's callbacks being invoked
+    StreamDecoder(Parser& parser, result_callback callback, size_t max_size = 16 * 1024 * 1024);
+
+    /// Decode the next chunk, callback is invoked for every message completed by it
+    void feed(const char* data, size_t size);
+    void feed(const std::string& data);
+    void feed(const char* data);
+#ifdef JSONRPCPP_HAS_CPP_17
+    void feed(std::string_view data);
+#endif
+
+    /// Discard the incomplete message
+    void reset();
+
+    /// Number of buffered bytes of the incomplete message
+    size_t pending() const
+    {
+        return buffer_.size();
+    }
+
+private:
+    /// Continue scanning the current message
+    /**
+     * @return the end of the message, nullptr if it doesn't end before last
+     */
+    const char* scan(const char* pos, const char* last);
+    void emit(const char* json_str, size_t size);
+
+    Parser* parser_;
+    result_callback callback_;
+    size_t max_size_;
+    std::string buffer_;
+    /// nesting level of the current message, 0 between messages
+    size_t depth_;
+    bool in_string_;
+    bool escape_;
+    /// the current message exceeds max_size_ and is skipped
+    bool skipping_;
+};
+
+
+/// Append the serialization of json to out, like out += json.dump(), but without a temporary string
+void append_json(const Json& json, std::string& out);
+
+
+/// @return the first '\n' in [first, last), last if there is none
+/**
+ * Compares 32 (AVX2) or 16 (SSE2, NEON) bytes at a time if the instruction sets are available
+ */
+const char* find_newline(const char* first, const char* last);
+
+
+/// Framing of newline-delimited JSON (NDJSON): one message per line
+/**
+ * Incoming lines are found with find_newline and parsed in place, only an
+ * incomplete last line of a chunk is buffered. A trailing '\r' is ignored,
+ * as are empty lines.
+ * A line longer than max_size is reported as ParseErrorException and skipped
+ * up to the next newline, without being buffered.
+ * Outgoing entities are appended with a trailing newline to a buffer that can
+ * collect several messages before it is written.
+ */
+class NdjsonCodec
+{
+public:
+    typedef StreamDecoder::result_callback result_callback;
+
+    /// Parse lines with Parser::do_try_parse
+    /// @param max_size maximum size of a line in bytes
+    explicit NdjsonCodec(result_callback callback, size_t max_size = 16 * 1024 * 1024);
+    /// Parse lines with parser.try_parse, i.e. with the parser's callbacks being invoked
+    NdjsonCodec(Parser& parser, result_callback callback, size_t max_size = 16 * 1024 * 1024);
+
+    /// Decode the next chunk, callback is invoked for every line completed by it
+    void feed(const char* data, size_t size);
+    void feed(const std::string& data);
+    void feed(const char* data);
+#ifdef JSONRPCPP_HAS_CPP_17
+    void feed(std::string_view data);
+#endif
+
+    /// Parse the buffered last line, for streams that don't end with a newline
+    void finish();
+    /// Discard the buffered incomplete line
+    void reset();
+
+    /// Number of buffered bytes of the incomplete line
+    size_t pending() const
+    {
+        return buffer_.size();
+    }
+
+    /// Append the entity and a newline to out
+    /**
+     * Newlines in the text of a RawJson result are replaced with spaces, so that
+     * the message stays on one line
+     */
+    static void encode(const Entity& entity, std::string& out);
+    static void encode(const Json& json, std::string& out);
+
+private:
+    void emit(const char* first, const char* last);
+
+    Parser* parser_;
+    result_callback callback_;
+    size_t max_size_;
+    std::string buffer_;
+    /// the current line exceeds max_size_ and is skipped
+    bool skipping_;
+};
+
+
+/// Framing with Content-Length headers, as in the base protocol of the Language Server Protocol
+/**
+ * Each message is preceded by a header of "Name: value" lines, terminated by an
+ * empty line. Content-Length is required and gives the size of the message in
+ * bytes, other header fields (e.g. Content-Type) are ignored.
+ * The header is parsed incrementally, without searching a partial header twice.
+ * Messages that are complete within the fed data are parsed in place. Otherwise
+ * the data is buffered, and can be read directly into the buffer with prepare()
+ * and commit(). The buffer grows with the received data, not with the announced
+ * Content-Length.
+ * A header without a valid Content-Length is reported as ParseErrorException and skipped.
+ * A Content-Length above max_size is reported as ParseErrorException, and the
+ * message is skipped without being buffered. A header above max_size is reported
+ * and discarded.
+ */
+class ContentLengthCodec
+{
+public:
+    typedef StreamDecoder::result_callback result_callback;
+
+    /// Parse messages with Parser::do_try_parse
+    /// @param max_size maximum size of a message and of a header in bytes
+    explicit ContentLengthCodec(result_callback callback, size_t max_size = 16 * 1024 * 1024);
+    /// Parse messages with parser.try_parse, i.e. with the parser's callbacks being invoked
+    ContentLengthCodec(Parser& parser, result_callback callback, size_t max_size = 16 * 1024 * 1024);
+
+    /// Decode the next chunk, callback is invoked for every message completed by it
+    void feed(const char* data, size_t size);
+    void feed(const std::string& data);
+    void feed(const char* data);
+#ifdef JSONRPCPP_HAS_CPP_17
+    void feed(std::string_view data);
+#endif
+
+    /// Writable space for up to size bytes of input, e.g. for a read from a socket
+    /**
+     * The space is valid until the next call of a non-const function
+     */
+    char* prepare(size_t size);
+    /// Decode the first size bytes written to the space returned by prepare()
+    void commit(size_t size);
+
+    /// Discard buffered input
+    void reset();
+
+    /// Number of buffered bytes of an incomplete message, including its header
+    size_t pending() const
+    {
+        return input_.size();
+    }
+
+    /// Append the header and the entity to out
+    /**
+     * The header is sized for the number of digits of the previously encoded
+     * message, so that the entity can be serialized right behind it.
+     */
+    void encode(const Entity& entity, std::string& out);
+    void encode(const Json& json, std::string& out);
+
+private:
+    /// Decode the complete messages in [data, data + size)
+    /**
+     * @return the number of consumed bytes
+     */
+    size_t decode(const char* data, size_t size);
+    /// Decode the buffered input and remove the consumed part
+    void decode_input();
+    /// Parse the header in [first, last) into content_length_
+    bool parse_header(const char* first, const char* last);
+    void emit(const char* json_str, size_t size);
+    /// Append the header and the message appended by serialize(out)
+    template <typename Serialize>
+    void encode_with(std::string& out, const Serialize& serialize);
+
+    Parser* parser_;
+    result_callback callback_;
+    size_t max_size_;
+    std::string input_;
+    /// size of input_ before prepare()
+    size_t prepared_;
+    /// bytes of the current header that have been searched for its end
+    size_t scanned_;
+    /// size of the current header including the empty line, 0 while it is incomplete
+    size_t header_size_;
+    size_t content_length_;
+    /// remaining bytes of a skipped message that exceeds max_size_
+    size_t skip_;
+    /// number of digits of the Content-Length of the last encoded message
+    size_t digits_;
+};
+
+
+/// Serializes the responses of a batch one by one, as soon as they are ready
+/**
+ * "[" is written with the first element, "]" by finish(). Only replies are
+ * written: responses and exceptions as they are, an Error (an invalid element)
+ * as response with a null id, and a Request without a registered callback as
+ * MethodNotFoundException. Notifications and nullptr are skipped, so a batch
+ * without responses produces no output at all, as required by JSON-RPC 2.0.
+ * The text is collected in a buffer that is passed to the sink whenever it
+ * reaches chunk_size bytes, and by finish().
+ * Can be used as callback of Parser::parse_streaming: a single message that is
+ * not part of a batch is written with write(), without brackets.
+ */
+class BatchWriter
+{
+public:
+    typedef std::function<void(const char* data, size_t size)> chunk_callback;
+
+    explicit BatchWriter(chunk_callback sink, size_t chunk_size = 16384);
+
+    /// Write the reply to entity as next element
+    void add(const entity_ptr& entity);
+    void add(const Entity& entity);
+    /// Write the reply to entity as a single message outside of a batch and flush
+    void write(const entity_ptr& entity);
+    void write(const Entity& entity);
+    /// Write the closing "]" and flush, nothing if no element was written
+    /**
+     * The writer can be used for the next batch afterwards
+     */
+    void finish();
+
+    /// Number of elements written to the current batch
+    size_t size() const
+    {
+        return size_;
+    }
+
+    void operator()(const entity_ptr& entity)
+    {
+        add(entity);
+    }
+
+    /// Callback of Parser::parse_streaming
+    void operator()(const entity_ptr& entity, bool batch_element)
+    {
+        if (batch_element)
+            add(entity);
+        else
+            write(entity);
+    }
+
+private:
+    /// Append the reply to entity to buffer_
+    /**
+     * @return false if there is no reply
+     */
+    bool append_reply(const Entity& entity);
+    void flush();
+
+    chunk_callback sink_;
+    size_t chunk_size_;
+    std::string buffer_;
+    size_t size_;
+};
+
+
+
+#ifdef JSONRPCPP_HAS_CPP_17
+//////////////////////// MemoryResourceScope implementation ///////////////////
+
+inline std::pmr::memory_resource* current_memory_resource()
+{
+    std::pmr::memory_resource* resource = MemoryResourceScope::active();
+    return (resource != nullptr) ? resource : std::pmr::get_default_resource();
+}
+
+inline MemoryResourceScope::MemoryResourceScope(std::pmr::memory_resource* resource) : previous_(active())
+{
+    active() = resource;
+}
+
+inline MemoryResourceScope::~MemoryResourceScope()
+{
+    active() = previous_;
+}
+
+inline std::pmr::memory_resource*& MemoryResourceScope::active()
+{
+    static thread_local std::pmr::memory_resource* resource = nullptr;
+    return resource;
+}
+#endif
+
+
+
+/////////////////////////// Members implementation ////////////////////////////
+
+inline Members::Members(const Json& json)
+{
+    if (!json.is_object())
+        return;
+
+    for (const auto& member : json.get_ref<const Json::object_t&>())
+    {
+        const std::string& key = member.first;
+        switch (key.size())
+        {
+            case 2:
+                if (key == "id")
+                    id = &member.second;
+                break;
+            case 5:
+                if (key == "error")
+                    error = &member.second;
+                break;
+            case 6:
+                if (key == "method")
+                    method = &member.second;
+                else if (key == "params")
+                    params = &member.second;
+                else if (key == "result")
+                    result = &member.second;
+                break;
+            case 7:
+                if (key == "jsonrpc")
+                    jsonrpc = &member.second;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+inline Json Members::take(const Json* value) const
+{
+    if (movable)
+        return std::move(*const_cast<Json*>(value));
+    return *value;
+}
+
+inline std::string Members::check_jsonrpc() const
+{
+    if (jsonrpc == nullptr)
+        return "jsonrpc is missing";
+    if (!jsonrpc->is_string())
+        return "invalid jsonrpc value: " + jsonrpc->dump();
+    const std::string& value = jsonrpc->get_ref<const Json::string_t&>();
+    if (value != "2.0")
+        return "invalid jsonrpc value: " + value;
+    return std::string();
+}
+
+inline Entity::entity_t Members::type() const
+{
+    if (method != nullptr)
+        return (id != nullptr) ? Entity::entity_t::request : Entity::entity_t::notification;
+    if (((result != nullptr) || (error != nullptr)) && (id != nullptr))
+        return Entity::entity_t::response;
+    return Entity::entity_t::unknown;
+}
+
+
+//////////////////////// OutputBuffer implementation //////////////////////////
+
+/// Output adapter of the nlohmann serializer that writes to an OutputBuffer
+class OutputBuffer::Adapter : public nlohmann::detail::output_adapter_protocol<char>
+{
+public:
+    explicit Adapter(OutputBuffer& out) : out_(out)
+    {
+    }
+
+    void write_character(char c) override
+    {
+        out_.write(&c, 1);
+    }
+
+    void write_characters(const char* s, std::size_t length) override
+    {
+        out_.write(s, length);
+    }
+
+private:
+    OutputBuffer& out_;
+};
+
+inline void OutputBuffer::write_static(const char* data, size_t size)
+{
+    write(data, size);
+}
+
+inline void OutputBuffer::write_shared(const std::shared_ptr<const std::string>& text)
+{
+    write(text->data(), text->size());
+}
+
+inline void OutputBuffer::write_json(const Json& json)
+{
+    nlohmann::detail::serializer<Json> serializer(std::make_shared<Adapter>(*this), ' ');
+    serializer.dump(json, false, false, 0);
+}
+
+inline void OutputBuffer::write_string(const std::string& str)
+{
+    // plain ASCII is written as is, anything that needs escaping or UTF-8 validation is left to the serializer
+    for (char c : str)
+    {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if ((uc < 0x20) || (uc >= 0x80) || (c == '"') || (c == '\\'))
+        {
+            write_json(Json(str));
+            return;
+        }
+    }
+    write_literal("\"");
+    write(str.data(), str.size());
+    write_literal("\"");
+}
+
+
+inline StringBuffer::StringBuffer(std::string& out) : out_(out)
+{
+}
+
+inline void StringBuffer::write(const char* data, size_t size)
+{
+    out_.append(data, size);
+}
+
+inline void StringBuffer::write_json(const Json& json)
+{
+    append_json(json, out_);
+}
+
+
+inline IovecBuffer::IovecBuffer(size_t min_reference_size, size_t chunk_size)
+    : min_reference_size_(min_reference_size), chunk_size_(chunk_size), chunk_pos_(nullptr), chunk_free_(0), size_(0)
+{
+}
+
+inline void IovecBuffer::write(const char* data, size_t size)
+{
+    if (size == 0)
+        return;
+    if (size > chunk_free_)
+    {
+        size_t chunk_size = std::max(chunk_size_, size);
+        chunks_.emplace_back(new char[chunk_size]);
+        chunk_pos_ = chunks_.back().get();
+        chunk_free_ = chunk_size;
+    }
+    memcpy(chunk_pos_, data, size);
+    add_segment(chunk_pos_, size);
+    chunk_pos_ += size;
+    chunk_free_ -= size;
+}
+
+inline void IovecBuffer::write_static(const char* data, size_t size)
+{
+    if (size < min_reference_size_)
+        write(data, size);
+    else
+        add_segment(data, size);
+}
+
+inline void IovecBuffer::write_shared(const std::shared_ptr<const std::string>& text)
+{
+    if (text->size() < min_reference_size_)
+    {
+        write(text->data(), text->size());
+        return;
+    }
+    shared_.push_back(text);
+    add_segment(text->data(), text->size());
+}
+
+inline void IovecBuffer::add_segment(const char* data, size_t size)
+{
+    size_ += size;
+    if (!segments_.empty() && (segments_.back().data + segments_.back().size == data))
+        segments_.back().size += size;
+    else
+        segments_.push_back({data, size});
+}
+
+inline std::string IovecBuffer::str() const
+{
+    std::string result;
+    result.reserve(size_);
+    for (const auto& segment : segments_)
+        result.append(segment.data, segment.size);
+    return result;
+}
+
+inline void IovecBuffer::clear()
+{
+    segments_.clear();
+    chunks_.clear();
+    chunk_pos_ = nullptr;
+    chunk_free_ = 0;
+    shared_.clear();
+    size_ = 0;
+}
+
+#ifdef JSONRPCPP_HAS_IOVEC
+inline void IovecBuffer::to_iovec(std::vector<struct iovec>& iov) const
+{
+    iov.reserve(iov.size() + segments_.size());
+    for (const auto& segment : segments_)
+    {
+        struct iovec vec;
+        vec.iov_base = const_cast<char*>(segment.data);
+        vec.iov_len = segment.size;
+        iov.push_back(vec);
+    }
+}
+#endif
+
+
+///////////////////////// Entity implementation /////////////////////////////
+
+inline Entity::Entity(entity_t type) : entity(type)
+{
+}
+
+inline bool Entity::is_exception() const
+{
+    return (entity == entity_t::exception);
+}
+
+inline bool Entity::is_id() const
+{
+    return (entity == entity_t::id);
+}
+
+inline bool Entity::is_error() const
+{
+    return (entity == entity_t::error);
+}
+
+inline bool Entity::is_response() const
+{
+    return (entity == entity_t::response);
+}
+
+inline bool Entity::is_request() const
+{
+    return (entity == entity_t::request);
+}
+
+inline bool Entity::is_notification() const
+{
+    return (entity == entity_t::notification);
+}
+
+inline bool Entity::is_batch() const
+{
+    return (entity == entity_t::batch);
+}
+
+inline void Entity::parse(const char* json_str)
+{
+    parse(json_str, strlen(json_str));
+}
+
+inline void Entity::parse(const char* json_str, size_t size)
+{
+    // http://www.jsonrpc.org/specification
+    //	code	message	meaning
+    //	-32700	Parse error	Invalid JSON was received by the server. An error occurred on the server while parsing the JSON text.
+    //	-32600	Invalid Request	The JSON sent is not a valid Request object.
+    //	-32601	Method not found	The method does not exist / is not available.
+    //	-32602	Invalid params	Invalid method parameter(s).
+    //	-32603	Internal error	Internal JSON-RPC error.
+    //	-32000 to -32099	Server error	Reserved for implementation-defined server-errors.
+    try
+    {
+        parse_json(Json::parse(json_str, json_str + size));
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+}
+
+inline void Entity::parse(const std::string& json_str)
+{
+    parse(json_str.data(), json_str.size());
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+inline void Entity::parse(std::string_view json_str)
+{
+    parse(json_str.data(), json_str.size());
+}
+#endif
+
+inline void Entity::write_to(OutputBuffer& out) const
+{
+    out.write_json(to_json());
+}
+
+inline void Entity::append_to(std::string& out) const
+{
+    StringBuffer buffer(out);
+    write_to(buffer);
+}
+
+inline void Entity::serialize(binary_format_t format, std::vector<uint8_t>& out) const
+{
+    switch (format)
+    {
+        case binary_format_t::cbor:
+            Json::to_cbor(to_json(), out);
+            break;
+        case binary_format_t::msgpack:
+            Json::to_msgpack(to_json(), out);
+            break;
+        case binary_format_t::ubjson:
+            Json::to_ubjson(to_json(), out);
+            break;
+        case binary_format_t::bjdata:
+            Json::to_bjdata(to_json(), out);
+            break;
+    }
+}
+
+inline std::string Entity::type_str() const
+{
+    switch (entity)
+    {
+        case entity_t::unknown:
+            return "unknown";
+        case entity_t::id:
+            return "id";
+        case entity_t::exception:
+            return "exception";
+        case entity_t::error:
+            return "error";
+        case entity_t::response:
+            return "response";
+        case entity_t::request:
+            return "request";
+        case entity_t::notification:
+            return "notification";
+        case entity_t::batch:
+            return "batch";
+        default:
+            return "unknown";
+    }
+}
+
+
+/////////////////////////// NullableEntity implementation /////////////////////
+
+inline NullableEntity::NullableEntity(entity_t type) : Entity(type), isNull(false)
+{
+}
+
+inline NullableEntity::NullableEntity(entity_t type, std::nullptr_t) : Entity(type), isNull(true)
+{
+}
+
+
+/////////////////////////// Id implementation /////////////////////////////////
+
+inline Id::Id() : Entity(entity_t::id), type_(value_t::null), int_id_(0), string_id_()
+{
+}
+
+inline Id::Id(std::nullptr_t) : Id()
+{
+}
+
+inline Id::Id(const char* id) : Entity(entity_t::id), type_(value_t::string), int_id_(0), string_id_(id)
+{
+}
+
+inline Id::Id(const std::string& id) : Entity(entity_t::id), type_(value_t::string), int_id_(0), string_id_(id)
+{
+}
+
+inline Id::Id(std::string&& id) : Entity(entity_t::id), type_(value_t::string), int_id_(0), string_id_(std::move(id))
+{
+}
+
+inline Id::Id(const Json& json_id) : Id()
+{
+    Id::parse_json(json_id);
+}
+
+inline void Id::set_integer(int64_t id)
+{
+    int_id_ = id;
+    type_ = value_t::integer;
+}
+
+inline void Id::set_unsigned(uint64_t id)
+{
+    if (id <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+    {
+        set_integer(static_cast<int64_t>(id));
+        return;
+    }
+    int_id_ = static_cast<int64_t>(id);
+    type_ = value_t::unsigned_integer;
+}
+
+inline int Id::rank() const
+{
+    switch (type_)
+    {
+        case value_t::null:
+            return 0;
+        case value_t::integer:
+            return 1;
+        case value_t::unsigned_integer:
+            return 2;
+        case value_t::string:
+            return 3;
+    }
+    return 0;
+}
+
+inline bool Id::is_valid(const Json& json)
+{
+    return json.is_null() || json.is_number_integer() || json.is_string();
+}
+
+inline void Id::parse_json(const Json& json)
+{
+    string_id_.clear();
+    int_id_ = 0;
+    if (json.is_null())
+    {
+        type_ = value_t::null;
+    }
+    else if (json.is_number_unsigned())
+    {
+        set_unsigned(json.get<uint64_t>());
+    }
+    else if (json.is_number_integer())
+    {
+        set_integer(json.get<int64_t>());
+    }
+    else if (json.is_string())
+    {
+        string_id_.assign(json.get_ref<const Json::string_t&>());
+        type_ = value_t::string;
+    }
+    else
+        throw std::invalid_argument("id must be integer, string or null");
+}
+
+inline void Id::write_to(OutputBuffer& out) const
+{
+    std::string number;
+    switch (type_)
+    {
+        case value_t::null:
+            out.write_literal("null");
+            return;
+        case value_t::string:
+            out.write_string(string_id_);
+            return;
+        case value_t::integer:
+            number = std::to_string(int_id_);
+            break;
+        case value_t::unsigned_integer:
+            number = std::to_string(uint64_id());
+            break;
+    }
+    out.write(number.data(), number.size());
+}
+
+inline Json Id::to_json() const
+{
+    if (type_ == value_t::null)
+        return nullptr;
+    if (type_ == value_t::string)
+        return string_id_;
+    if (type_ == value_t::integer)
+        return int_id_;
+    if (type_ == value_t::unsigned_integer)
+        return uint64_id();
+
+    return nullptr;
+}
+
+inline bool Id::operator<(const Id& other) const
+{
+    if (type_ != other.type_)
+        return rank() < other.rank();
+    switch (type_)
+    {
+        case value_t::integer:
+            return int_id_ < other.int_id_;
+        case value_t::unsigned_integer:
+            return uint64_id() < other.uint64_id();
+        case value_t::string:
+            return string_id_ < other.string_id_;
+        default:
+            return false;
+    }
+}
+
+inline bool Id::operator==(const Id& other) const
+{
+    if (type_ != other.type_)
+        return false;
+    if (type_ == value_t::string)
+        return string_id_ == other.string_id_;
+    return int_id_ == other.int_id_;
+}
+
+inline size_t Id::hash() const
+{
+    if (type_ == value_t::string)
+        return std::hash<std::string>()(string_id_);
+    // null and both integer kinds hash the stored 64 bit value, mixed with the type
+    return std::hash<int64_t>()(int_id_) ^ static_cast<size_t>(type_);
+}
+
+
+
+//////////////////////// Error implementation /////////////////////////////////
+
+inline Parameter::Parameter(std::nullptr_t)
+    : NullableEntity(entity_t::id, nullptr), type(value_t::null), value_(nullptr), raw_data_(nullptr), raw_size_(0), raw_pending_(false)
+{
+}
+
+inline Parameter::Parameter(const Json& json)
+    : NullableEntity(entity_t::id), type(value_t::null), value_(nullptr), raw_data_(nullptr), raw_size_(0), raw_pending_(false)
+{
+    if (json != nullptr)
+        Parameter::parse_json(json);
+}
+
+inline Parameter::Parameter(Json&& json)
+    : NullableEntity(entity_t::id), type(value_t::null), value_(nullptr), raw_data_(nullptr), raw_size_(0), raw_pending_(false)
+{
+    if (json != nullptr)
+        Parameter::parse_json(std::move(json));
+}
+
+inline Parameter::Parameter(const std::string& key1, const Json& value1, const std::string& key2, const Json& value2, const std::string& key3,
+                            const Json& value3, const std::string& key4, const Json& value4)
+    : NullableEntity(entity_t::id), type(value_t::map), value_(Json::value_t::object), raw_data_(nullptr), raw_size_(0), raw_pending_(false)
+{
+    value_[key1] = value1;
+    if (!key2.empty())
+        add(key2, value2);
+    if (!key3.empty())
+        add(key3, value3);
+    if (!key4.empty())
+        add(key4, value4);
+}
+
+inline bool Parameter::is_valid(const Json& json)
+{
+    return json.is_null() || json.is_array() || json.is_object();
+}
+
+inline bool Parameter::is_valid_raw(const char* json_str, size_t size)
+{
+    JsonScanner scanner(json_str, json_str + size);
+    char c = scanner.peek();
+    return (c == '[') || (c == '{') || (c == 'n');
+}
+
+inline Parameter Parameter::from_raw(const char* json_str, size_t size)
+{
+    Parameter parameter(nullptr);
+    JsonScanner scanner(json_str, json_str + size);
+    switch (scanner.peek())
+    {
+        case '[':
+            parameter.type = value_t::array;
+            break;
+        case '{':
+            parameter.type = value_t::map;
+            break;
+        case 'n':
+            // null is decoded right away, to have it validated
+        default:
+            // not a valid parameter type, decoding will fail with the same error as for a Json
+            try
+            {
+                parameter.parse_json(Json::parse(json_str, json_str + size));
+            }
+            catch (const Json::parse_error& e)
+            {
+                throw ParseErrorException(e.what());
+            }
+            parameter.raw_data_ = json_str;
+            parameter.raw_size_ = size;
+            return parameter;
+    }
+    parameter.isNull = false;
+    parameter.raw_data_ = json_str;
+    parameter.raw_size_ = size;
+    parameter.raw_pending_ = true;
+    return parameter;
+}
+
+inline void Parameter::decode() const
+{
+    if (!raw_pending_)
+        return;
+
+    try
+    {
+        value_ = Json::parse(raw_data(), raw_data() + raw_size());
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+    raw_pending_ = false;
+}
+
+inline bool Parameter::is_raw() const
+{
+    return raw_pending_;
+}
+
+inline std::string Parameter::raw() const
+{
+    if (raw_data() == nullptr)
+        return std::string();
+    return std::string(raw_data(), raw_size());
+}
+
+inline const char* Parameter::raw_data() const
+{
+    if (raw_data_ != nullptr)
+        return raw_data_;
+    return raw_copy_.empty() ? nullptr : raw_copy_.data();
+}
+
+inline size_t Parameter::raw_size() const
+{
+    return (raw_data_ != nullptr) ? raw_size_ : raw_copy_.size();
+}
+
+inline void Parameter::detach()
+{
+    if (raw_data_ == nullptr)
+        return;
+    raw_copy_.assign(raw_data_, raw_size_);
+    raw_data_ = nullptr;
+    raw_size_ = 0;
+}
+
+inline void Parameter::add(const std::string& key, const Json& value)
+{
+    decode();
+    if (type == value_t::null)
+    {
+        value_ = Json::object();
+        type = value_t::map;
+        isNull = false;
+    }
+    value_[key] = value;
+}
+
+inline void Parameter::parse_json(const Json& json)
+{
+    parse_json(Json(json));
+}
+
+inline void Parameter::parse_json(Json&& json)
+{
+    raw_data_ = nullptr;
+    raw_size_ = 0;
+    raw_copy_.clear();
+    raw_pending_ = false;
+    if (json.is_null())
+        type = value_t::null;
+    else if (json.is_array())
+        type = value_t::array;
+    else if (json.is_object())
+        type = value_t::map;
+    else
+        throw std::invalid_argument("params must be an array, an object or null");
+    isNull = (type == value_t::null);
+    value_ = std::move(json);
+}
+
+inline Json Parameter::to_json() const
+{
+    return value();
+}
+
+inline void Parameter::write_to(OutputBuffer& out) const
+{
+    out.write_json(value());
+}
+
+inline const Json& Parameter::value() const
+{
+    decode();
+    return value_;
+}
+
+inline bool Parameter::is_array() const
+{
+    return type == value_t::array;
+}
+
+inline bool Parameter::is_map() const
+{
+    return type == value_t::map;
+}
+
+inline bool Parameter::is_null() const
+{
+    return type == value_t::null;
+}
+
+inline bool Parameter::has(const std::string& key) const
+{
+    if (type != value_t::map)
+        return false;
+    decode();
+    return (value_.find(key) != value_.end());
+}
+
+inline const Json& Parameter::get(const std::string& key) const
+{
+    if (type == value_t::map)
+    {
+        decode();
+        auto it = value_.find(key);
+        if (it != value_.end())
+            return *it;
+    }
+    throw std::out_of_range("parameter not found: " + key);
+}
+
+inline bool Parameter::has(size_t idx) const
+{
+    if (type != value_t::array)
+        return false;
+    decode();
+    return (value_.size() > idx);
+}
+
+inline const Json& Parameter::get(size_t idx) const
+{
+    if (has(idx))
+        return value_[idx];
+    throw std::out_of_range("parameter index out of range: " + std::to_string(idx));
+}
+
+
+//////////////////////// Error implementation /////////////////////////////////
+
+inline Error::Error(const Json& json) : Error("Internal error", -32603, nullptr)
+{
+    if (json != nullptr)
+        Error::parse_json(json);
+}
+
+inline Error::Error(std::nullptr_t) : NullableEntity(entity_t::error, nullptr), code_(0), message_(""), data_(nullptr)
+{
+}
+
+inline Error::Error(const std::string& message, int code, const Json& data) : NullableEntity(entity_t::error), code_(code), message_(message), data_(data)
+{
+}
+
+inline std::string Error::check_json(const Json& json)
+{
+    auto code = json.find("code");
+    if (code == json.end())
+        return "code is missing";
+    if (!code->is_number())
+        return "code must be a number";
+    auto message = json.find("message");
+    if (message == json.end())
+        return "message is missing";
+    if (!message->is_string())
+        return "message must be a string";
+    return std::string();
+}
+
+inline void Error::parse_json(const Json& json)
+{
+    try
+    {
+        auto code = json.find("code");
+        if (code == json.end())
+            throw RpcException("code is missing");
+        code_ = *code;
+        auto message = json.find("message");
+        if (message == json.end())
+            throw RpcException("message is missing");
+        message_ = message->get<std::string>();
+        auto data = json.find("data");
+        if (data != json.end())
+            data_ = *data;
+        else
+            data_ = nullptr;
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw RpcException(e.what());
+    }
+}
+
+inline Json Error::to_json() const
+{
+    Json j = {{"code", code_}, {"message", message_}};
+
+    if (!data_.is_null())
+        j["data"] = data_;
+    return j;
+}
+
+inline void Error::write_to(OutputBuffer& out) const
+{
+    // keys in the order of to_json().dump()
+    std::string code = std::to_string(code_);
+    out.write_literal("{\"code\":");
+    out.write(code.data(), code.size());
+    if (!data_.is_null())
+    {
+        out.write_literal(",\"data\":");
+        out.write_json(data_);
+    }
+    out.write_literal(",\"message\":");
+    out.write_string(message_);
+    out.write_literal("}");
+}
+
+
+////////////////////// Request implementation /////////////////////////////////
+
+inline Request::Request(const Json& json) : Entity(entity_t::request), method_(""), id_()
+{
+    if (json != nullptr)
+        Request::parse_json(json);
+}
+
+inline Request::Request(const Id& id, const std::string& method, const Parameter& params) : Entity(entity_t::request), method_(method), params_(params), id_(id)
+{
+}
+
+inline void Request::assign(const Id& id, const std::string& method, const Parameter& params)
+{
+    id_ = id;
+    method_.assign(method);
+    params_ = params;
+}
+
+inline void Request::parse_json(const Json& json)
+{
+    parse_members(Members(json));
+}
+
+inline void Request::parse_members(const Members& members)
+{
+    ParseResult result;
+    try
+    {
+        result = try_parse_members(members);
+    }
+    catch (const std::exception& e)
+    {
+        throw InternalErrorException(e.what(), id_);
+    }
+    if (!result)
+        result.throw_error();
+}
+
+inline ParseResult Request::try_parse_members(const Members& members)
+{
+    if (members.id == nullptr)
+        return InvalidRequestException("id is missing");
+    if (!Id::is_valid(*members.id))
+        return InvalidRequestException("id must be integer, string or null");
+    id_.parse_json(*members.id);
+
+    std::string jsonrpc_error = members.check_jsonrpc();
+    if (!jsonrpc_error.empty())
+        return InvalidRequestException(jsonrpc_error, id_);
+
+    if (members.method == nullptr)
+        return InvalidRequestException("method is missing", id_);
+    if (!members.method->is_string())
+        return InvalidRequestException("method must be a string value", id_);
+    method_.assign(members.method->get_ref<const Json::string_t&>());
+    if (method_.empty())
+        return InvalidRequestException("method must not be empty", id_);
+
+    if (members.params != nullptr)
+    {
+        if (!Parameter::is_valid(*members.params))
+            return InternalErrorException("params must be an array, an object or null", id_);
+        params_.parse_json(members.take(members.params));
+    }
+    else if (members.raw_params != nullptr)
+    {
+        if (!Parameter::is_valid_raw(members.raw_params, members.raw_params_size))
+            return InternalErrorException("params must be an array, an object or null", id_);
+        try
+        {
+            params_ = Parameter::from_raw(members.raw_params, members.raw_params_size);
+        }
+        catch (const ParseErrorException& e)
+        {
+            return e;
+        }
+    }
+    else
+        params_ = nullptr;
+    return ParseResult();
+}
+
+inline Json Request::to_json() const
+{
+    Json json = {{"jsonrpc", "2.0"}, {"method", method_}, {"id", id_.to_json()}};
+
+    if (params_)
+        json["params"] = params_.to_json();
+
+    return json;
+}
+
+inline void Request::write_to(OutputBuffer& out) const
+{
+    out.write_literal("{\"id\":");
+    id_.write_to(out);
+    out.write_literal(",\"jsonrpc\":\"2.0\",\"method\":");
+    out.write_string(method_);
+    if (params_)
+    {
+        out.write_literal(",\"params\":");
+        params_.write_to(out);
+    }
+    out.write_literal("}");
+}
+
+
+inline RpcException::RpcException(const char* text) : m_(text)
+{
+}
+
+inline RpcException::RpcException(const std::string& text) : RpcException(text.c_str())
+{
+}
+
+inline const char* RpcException::what() const noexcept
+{
+    return m_.what();
+}
+
+
+inline RpcEntityException::RpcEntityException(const Error& error) : RpcException(error.message()), Entity(entity_t::exception), error_(error)
+{
+}
+
+inline void RpcEntityException::parse_json(const Json& /*json*/)
+{
+}
+
+
+inline ParseErrorException::ParseErrorException(const Error& error) : RpcEntityException(error)
+{
+}
+
+inline ParseErrorException::ParseErrorException(const std::string& data) : ParseErrorException(Error("Parse error", -32700, data))
+{
+}
+
+inline Json ParseErrorException::to_json() const
+{
+    Json response = {{"jsonrpc", "2.0"}, {"error", error_.to_json()}, {"id", nullptr}};
+
+    return response;
+}
+
+inline void ParseErrorException::write_to(OutputBuffer& out) const
+{
+    out.write_literal("{\"error\":");
+    error_.write_to(out);
+    out.write_literal(",\"id\":null,\"jsonrpc\":\"2.0\"}");
+}
+
+
+inline RequestException::RequestException(const Error& error, const Id& requestId) : RpcEntityException(error), id_(requestId)
+{
+}
+
+inline Json RequestException::to_json() const
+{
+    Json response = {{"jsonrpc", "2.0"}, {"error", error_.to_json()}, {"id", id_.to_json()}};
+
+    return response;
+}
+
+inline void RequestException::write_to(OutputBuffer& out) const
+{
+    out.write_literal("{\"error\":");
+    error_.write_to(out);
+    out.write_literal(",\"id\":");
+    id_.write_to(out);
+    out.write_literal(",\"jsonrpc\":\"2.0\"}");
+}
+
+
+inline InvalidRequestException::InvalidRequestException(const Id& requestId) : RequestException(Error("Invalid request", -32600), requestId)
+{
+}
+
+inline InvalidRequestException::InvalidRequestException(const Request& request) : InvalidRequestException(request.id())
+{
+}
+
+inline InvalidRequestException::InvalidRequestException(const char* data, const Id& requestId)
+    : RequestException(Error("Invalid request", -32600, data), requestId)
+{
+}
+
+inline InvalidRequestException::InvalidRequestException(const std::string& data, const Id& requestId) : InvalidRequestException(data.c_str(), requestId)
+{
+}
+
+
+inline MethodNotFoundException::MethodNotFoundException(const Id& requestId) : RequestException(Error("Method not found", -32601), requestId)
+{
+}
+
+inline MethodNotFoundException::MethodNotFoundException(const Request& request) : MethodNotFoundException(request.id())
+{
+}
+
+inline MethodNotFoundException::MethodNotFoundException(const char* data, const Id& requestId)
+    : RequestException(Error("Method not found", -32601, data), requestId)
+{
+}
+
+inline MethodNotFoundException::MethodNotFoundException(const std::string& data, const Id& requestId) : MethodNotFoundException(data.c_str(), requestId)
+{
+}
+
+
+inline InvalidParamsException::InvalidParamsException(const Id& requestId) : RequestException(Error("Invalid params", -32602), requestId)
+{
+}
+
+inline InvalidParamsException::InvalidParamsException(const Request& request) : InvalidParamsException(request.id())
+{
+}
+
+inline InvalidParamsException::InvalidParamsException(const char* data, const Id& requestId)
+    : RequestException(Error("Invalid params", -32602, data), requestId)
+{
+}
+
+inline InvalidParamsException::InvalidParamsException(const std::string& data, const Id& requestId) : InvalidParamsException(data.c_str(), requestId)
+{
+}
+
+
+inline InternalErrorException::InternalErrorException(const Id& requestId) : RequestException(Error("Internal error", -32603), requestId)
+{
+}
+
+inline InternalErrorException::InternalErrorException(const Request& request) : InternalErrorException(request.id())
+{
+}
+
+inline InternalErrorException::InternalErrorException(const char* data, const Id& requestId)
+    : RequestException(Error("Internal error", -32603, data), requestId)
+{
+}
+
+inline InternalErrorException::InternalErrorException(const std::string& data, const Id& requestId) : InternalErrorException(data.c_str(), requestId)
+{
+}
+
+
+//////////////////////// ParseResult implementation ///////////////////////////
+
+inline ParseResult::ParseResult(entity_ptr entity) : kind_(error_t::none), entity_(std::move(entity)), error_(nullptr)
+{
+}
+
+inline ParseResult::ParseResult(const ParseErrorException& exception) : kind_(error_t::parse_error), error_(exception.error())
+{
+}
+
+inline ParseResult::ParseResult(const RequestException& exception) : kind_(error_t::request_error), error_(exception.error()), id_(exception.id())
+{
+}
+
+inline ParseResult::ParseResult(const RpcException& exception) : kind_(error_t::rpc_error), error_(exception.what(), -32600)
+{
+}
+
+inline entity_ptr ParseResult::value_or_throw() const
+{
+    if (kind_ != error_t::none)
+        throw_error();
+    return entity_;
+}
+
+inline void ParseResult::throw_error() const
+{
+    switch (kind_)
+    {
+        case error_t::parse_error:
+            throw ParseErrorException(error_);
+        case error_t::request_error:
+        {
+            const Json& data = error_.data();
+            if (!data.is_null() && !data.is_string())
+                throw RequestException(error_, id_);
+            std::string text = data.is_string() ? data.get<std::string>() : std::string();
+            switch (error_.code())
+            {
+                case -32600:
+                    throw data.is_null() ? InvalidRequestException(id_) : InvalidRequestException(text, id_);
+                case -32601:
+                    throw data.is_null() ? MethodNotFoundException(id_) : MethodNotFoundException(text, id_);
+                case -32602:
+                    throw data.is_null() ? InvalidParamsException(id_) : InvalidParamsException(text, id_);
+                case -32603:
+                    throw data.is_null() ? InternalErrorException(id_) : InternalErrorException(text, id_);
+                default:
+                    throw RequestException(error_, id_);
+            }
+        }
+        case error_t::rpc_error:
+            throw RpcException(error_.message());
+        default:
+            throw std::logic_error("ParseResult has no error");
+    }
+}
+
+
+//////////////////////// RawJson implementation ///////////////////////////////
+
+inline RawJson::RawJson(std::string json_str) : RawJson(std::make_shared<const std::string>(std::move(json_str)))
+{
+}
+
+inline RawJson::RawJson(std::shared_ptr<const std::string> json_str) : RawJson(std::move(json_str), trusted_t())
+{
+    if (!is_valid())
+        throw ParseErrorException("raw JSON is not valid");
+}
+
+inline RawJson::RawJson(std::shared_ptr<const std::string> json_str, trusted_t) : json_str_(std::move(json_str))
+{
+    if (!json_str_)
+        json_str_ = std::make_shared<const std::string>("null");
+}
+
+inline RawJson RawJson::trusted(std::string json_str)
+{
+    return RawJson(std::make_shared<const std::string>(std::move(json_str)), trusted_t());
+}
+
+inline RawJson RawJson::trusted(std::shared_ptr<const std::string> json_str)
+{
+    return RawJson(std::move(json_str), trusted_t());
+}
+
+inline bool RawJson::is_valid() const
+{
+    return Json::accept(json_str_->begin(), json_str_->end());
+}
+
+inline Json RawJson::parse() const
+{
+    try
+    {
+        return Json::parse(json_str_->begin(), json_str_->end());
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+}
+
+
+///////////////////// Response implementation /////////////////////////////////
+
+inline Response::Response(const Json& json) : Entity(entity_t::response)
+{
+    if (json != nullptr)
+        Response::parse_json(json);
+}
+
+inline Response::Response(const Id& id, const Json& result) : Entity(entity_t::response), id_(id), result_(result), error_(nullptr)
+{
+}
+
+inline Response::Response(const Id& id, const RawJson& result)
+    : Entity(entity_t::response), id_(id), result_(), error_(nullptr), raw_result_(result.ptr()), raw_pending_(true)
+{
+}
+
+inline Response::Response(const Id& id, const Error& error) : Entity(entity_t::response), id_(id), result_(), error_(error)
+{
+}
+
+inline Response::Response(const Request& request, const RawJson& result) : Response(request.id(), result)
+{
+}
+
+inline Response::Response(const Request& request, const Json& result) : Response(request.id(), result)
+{
+}
+
+inline Response::Response(const Request& request, const Error& error) : Response(request.id(), error)
+{
+}
+
+inline Response::Response(const RequestException& exception) : Response(exception.id(), exception.error())
+{
+}
+
+inline void Response::assign(const Id& id, const Json& result)
+{
+    id_ = id;
+    result_ = result;
+    error_ = nullptr;
+    raw_result_ = nullptr;
+    raw_pending_ = false;
+}
+
+inline void Response::assign(const Id& id, const RawJson& result)
+{
+    id_ = id;
+    result_ = nullptr;
+    error_ = nullptr;
+    raw_result_ = result.ptr();
+    raw_pending_ = true;
+}
+
+inline void Response::assign(const Id& id, const Error& error)
+{
+    id_ = id;
+    result_ = nullptr;
+    error_ = error;
+    raw_result_ = nullptr;
+    raw_pending_ = false;
+}
+
+inline void Response::assign(const Request& request, const Json& result)
+{
+    assign(request.id(), result);
+}
+
+inline void Response::assign(const Request& request, const RawJson& result)
+{
+    assign(request.id(), result);
+}
+
+inline void Response::assign(const Request& request, const Error& error)
+{
+    assign(request.id(), error);
+}
+
+inline void Response::assign(const RequestException& exception)
+{
+    assign(exception.id(), exception.error());
+}
+
+inline void Response::parse_json(const Json& json)
+{
+    parse_members(Members(json));
+}
+
+inline void Response::parse_members(const Members& members)
+{
+    ParseResult result;
+    try
+    {
+        result = try_parse_members(members);
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw RpcException(e.what());
+    }
+    if (!result)
+        result.throw_error();
+}
+
+inline ParseResult Response::try_parse_members(const Members& members)
+{
+    error_ = nullptr;
+    result_ = nullptr;
+    raw_result_ = nullptr;
+    raw_pending_ = false;
+    std::string jsonrpc_error = members.check_jsonrpc();
+    if (!jsonrpc_error.empty())
+        return RpcException(jsonrpc_error);
+    if (members.id == nullptr)
+        return RpcException("id is missing");
+    if (!Id::is_valid(*members.id))
+        return RpcException("id must be integer, string or null");
+    id_.parse_json(*members.id);
+    if (members.result != nullptr)
+    {
+        result_ = members.take(members.result);
+    }
+    else if (members.error != nullptr)
+    {
+        std::string error = Error::check_json(*members.error);
+        if (!error.empty())
+            return RpcException(error);
+        error_ = *members.error;
+    }
+    else
+        return RpcException("response must contain result or error");
+    return ParseResult();
+}
+
+inline Json Response::to_json() const
+{
+    Json j = {{"jsonrpc", "2.0"}, {"id", id_.to_json()}};
+
+    if (error_)
+        j["error"] = error_.to_json();
+    else
+        j["result"] = result();
+
+    return j;
+}
+
+inline const Json& Response::result() const
+{
+    if (raw_pending_)
+    {
+        result_ = RawJson::trusted(raw_result_).parse();
+        raw_pending_ = false;
+    }
+    return result_;
+}
+
+inline void Response::write_to(OutputBuffer& out) const
+{
+    if (error_)
+    {
+        out.write_literal("{\"error\":");
+        error_.write_to(out);
+        out.write_literal(",\"id\":");
+        id_.write_to(out);
+        out.write_literal(",\"jsonrpc\":\"2.0\"}");
+    }
+    else
+    {
+        out.write_literal("{\"id\":");
+        id_.write_to(out);
+        out.write_literal(",\"jsonrpc\":\"2.0\",\"result\":");
+        if (raw_result_)
+            out.write_shared(raw_result_);
+        else
+            out.write_json(result_);
+        out.write_literal("}");
+    }
+}
+
+
+///////////////// Notification implementation /////////////////////////////////
+
+inline Notification::Notification(const Json& json) : Entity(entity_t::notification)
+{
+    if (json != nullptr)
+        Notification::parse_json(json);
+}
+
+inline Notification::Notification(const char* method, const Parameter& params) : Entity(entity_t::notification), method_(method), params_(params)
+{
+}
+
+inline Notification::Notification(const std::string& method, const Parameter& params) : Notification(method.c_str(), params)
+{
+}
+
+inline void Notification::assign(const std::string& method, const Parameter& params)
+{
+    method_.assign(method);
+    params_ = params;
+}
+
+inline void Notification::parse_json(const Json& json)
+{
+    parse_members(Members(json));
+}
+
+inline void Notification::parse_members(const Members& members)
+{
+    ParseResult result;
+    try
+    {
+        result = try_parse_members(members);
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw RpcException(e.what());
+    }
+    if (!result)
+        result.throw_error();
+}
+
+inline ParseResult Notification::try_parse_members(const Members& members)
+{
+    std::string jsonrpc_error = members.check_jsonrpc();
+    if (!jsonrpc_error.empty())
+        return RpcException(jsonrpc_error);
+
+    if (members.method == nullptr)
+        return RpcException("method is missing");
+    if (!members.method->is_string())
+        return RpcException("method must be a string value");
+    method_.assign(members.method->get_ref<const Json::string_t&>());
+    if (method_.empty())
+        return RpcException("method must not be empty");
+
+    if (members.params != nullptr)
+    {
+        if (!Parameter::is_valid(*members.params))
+            return RpcException("params must be an array, an object or null");
+        params_.parse_json(members.take(members.params));
+    }
+    else if (members.raw_params != nullptr)
+    {
+        if (!Parameter::is_valid_raw(members.raw_params, members.raw_params_size))
+            return RpcException("params must be an array, an object or null");
+        try
+        {
+            params_ = Parameter::from_raw(members.raw_params, members.raw_params_size);
+        }
+        catch (const ParseErrorException& e)
+        {
+            return e;
+        }
+    }
+    else
+        params_ = nullptr;
+    return ParseResult();
+}
+
+inline Json Notification::to_json() const
+{
+    Json json = {{"jsonrpc", "2.0"}, {"method", method_}};
+
+    if (params_)
+        json["params"] = params_.to_json();
+
+    return json;
+}
+
+inline void Notification::write_to(OutputBuffer& out) const
+{
+    out.write_literal("{\"jsonrpc\":\"2.0\",\"method\":");
+    out.write_string(method_);
+    if (params_)
+    {
+        out.write_literal(",\"params\":");
+        params_.write_to(out);
+    }
+    out.write_literal("}");
+}
+
+
+//////////////////////// Batch implementation /////////////////////////////////
+
+inline Batch::Batch(const Json& json) : Entity(entity_t::batch)
+{
+    if (json != nullptr)
+        Batch::parse_json(json);
+}
+
+inline void Batch::parse_json(const Json& json)
+{
+    //	cout << "Batch::parse: " << json.dump() << "\n";
+    entities.clear();
+    for (const auto& it : json)
+    {
+        //		cout << "x: " << it->dump() << "\n";
+        if (it.is_object())
+            entities.push_back(to_element(Parser::do_try_parse_members(Members(it))));
+        else
+            entities.push_back(parse_element([&it]() { return Parser::do_parse_json(it); }));
+    }
+    if (entities.empty())
+        throw InvalidRequestException();
+}
+
+template <typename Parse>
+inline entity_ptr Batch::parse_element(const Parse& parse)
+{
+    entity_ptr entity(nullptr);
+    try
+    {
+        entity = parse();
+        if (!entity)
+            entity = make_entity<Error>("Invalid Request", -32600);
+    }
+    catch (const RequestException& e)
+    {
+        entity = make_entity<RequestException>(e);
+    }
+    catch (const std::exception& e)
+    {
+        entity = make_entity<Error>(e.what(), -32600);
+    }
+    return entity;
+}
+
+inline entity_ptr Batch::to_element(const ParseResult& result)
+{
+    switch (result.kind())
+    {
+        case ParseResult::error_t::none:
+            if (result.entity())
+                return result.entity();
+            return make_entity<Error>("Invalid Request", -32600);
+        case ParseResult::error_t::request_error:
+            return make_entity<RequestException>(result.error(), result.id());
+        default:
+            return make_entity<Error>(result.error().message(), -32600);
+    }
+}
+
+inline Json Batch::to_json() const
+{
+    Json result;
+    for (const auto& j : entities)
+        result.push_back(j->to_json());
+    return result;
+}
+
+inline void Batch::write_to(OutputBuffer& out) const
+{
+    // an empty batch is null, like in to_json()
+    if (entities.empty())
+    {
+        out.write_literal("null");
+        return;
+    }
+    out.write_literal("[");
+    for (size_t n = 0; n < entities.size(); ++n)
+    {
+        if (n != 0)
+            out.write_literal(",");
+        entities[n]->write_to(out);
+    }
+    out.write_literal("]");
+}
+
+
+//////////////////////// AnyEntity implementation /////////////////////////////
+
+inline AnyEntity::AnyEntity() : type_(Entity::entity_t::unknown)
+{
+}
+
+inline AnyEntity::AnyEntity(Request request) : type_(Entity::entity_t::request)
+{
+    new (&request_) Request(std::move(request));
+}
+
+inline AnyEntity::AnyEntity(Notification notification) : type_(Entity::entity_t::notification)
+{
+    new (&notification_) Notification(std::move(notification));
+}
+
+inline AnyEntity::AnyEntity(Response response) : type_(Entity::entity_t::response)
+{
+    new (&response_) Response(std::move(response));
+}
+
+inline AnyEntity::AnyEntity(Batch batch) : type_(Entity::entity_t::batch)
+{
+    new (&batch_) Batch(std::move(batch));
+}
+
+inline AnyEntity::AnyEntity(Error error) : type_(Entity::entity_t::error)
+{
+    new (&error_) Error(std::move(error));
+}
+
+inline AnyEntity::AnyEntity(RequestException exception) : type_(Entity::entity_t::exception)
+{
+    new (&exception_) RequestException(std::move(exception));
+}
+
+inline AnyEntity::AnyEntity(const AnyEntity& other) : type_(Entity::entity_t::unknown)
+{
+    copy_from(other);
+}
+
+inline AnyEntity::AnyEntity(AnyEntity&& other) noexcept : type_(Entity::entity_t::unknown)
+{
+    move_from(other);
+}
+
+inline AnyEntity& AnyEntity::operator=(const AnyEntity& other)
+{
+    if (this != &other)
+    {
+        destroy();
+        copy_from(other);
+    }
+    return *this;
+}
+
+inline AnyEntity& AnyEntity::operator=(AnyEntity&& other) noexcept
+{
+    if (this != &other)
+    {
+        destroy();
+        move_from(other);
+    }
+    return *this;
+}
+
+inline AnyEntity::~AnyEntity()
+{
+    destroy();
+}
+
+inline void AnyEntity::copy_from(const AnyEntity& other)
+{
+    switch (other.type_)
+    {
+        case Entity::entity_t::request:
+            new (&request_) Request(other.request_);
+            break;
+        case Entity::entity_t::notification:
+            new (&notification_) Notification(other.notification_);
+            break;
+        case Entity::entity_t::response:
+            new (&response_) Response(other.response_);
+            break;
+        case Entity::entity_t::batch:
+            new (&batch_) Batch(other.batch_);
+            break;
+        case Entity::entity_t::error:
+            new (&error_) Error(other.error_);
+            break;
+        case Entity::entity_t::exception:
+            new (&exception_) RequestException(other.exception_);
+            break;
+        default:
+            break;
+    }
+    type_ = other.type_;
+}
+
+inline void AnyEntity::move_from(AnyEntity& other)
+{
+    switch (other.type_)
+    {
+        case Entity::entity_t::request:
+            new (&request_) Request(std::move(other.request_));
+            break;
+        case Entity::entity_t::notification:
+            new (&notification_) Notification(std::move(other.notification_));
+            break;
+        case Entity::entity_t::response:
+            new (&response_) Response(std::move(other.response_));
+            break;
+        case Entity::entity_t::batch:
+            new (&batch_) Batch(std::move(other.batch_));
+            break;
+        case Entity::entity_t::error:
+            new (&error_) Error(std::move(other.error_));
+            break;
+        case Entity::entity_t::exception:
+            new (&exception_) RequestException(std::move(other.exception_));
+            break;
+        default:
+            break;
+    }
+    type_ = other.type_;
+}
+
+inline void AnyEntity::destroy()
+{
+    switch (type_)
+    {
+        case Entity::entity_t::request:
+            request_.~Request();
+            break;
+        case Entity::entity_t::notification:
+            notification_.~Notification();
+            break;
+        case Entity::entity_t::response:
+            response_.~Response();
+            break;
+        case Entity::entity_t::batch:
+            batch_.~Batch();
+            break;
+        case Entity::entity_t::error:
+            error_.~Error();
+            break;
+        case Entity::entity_t::exception:
+            exception_.~RequestException();
+            break;
+        default:
+            break;
+    }
+    type_ = Entity::entity_t::unknown;
+}
+
+inline AnyEntity AnyEntity::from_members(const Members& members)
+{
+    AnyEntity result;
+    try
+    {
+        switch (members.type())
+        {
+            case Entity::entity_t::request:
+                new (&result.request_) Request();
+                result.type_ = Entity::entity_t::request;
+                result.request_.parse_members(members);
+                break;
+            case Entity::entity_t::notification:
+                new (&result.notification_) Notification();
+                result.type_ = Entity::entity_t::notification;
+                result.notification_.parse_members(members);
+                break;
+            case Entity::entity_t::response:
+                new (&result.response_) Response();
+                result.type_ = Entity::entity_t::response;
+                result.response_.parse_members(members);
+                break;
+            default:
+                break;
+        }
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw RpcException(e.what());
+    }
+    return result;
+}
+
+inline Entity* AnyEntity::get()
+{
+    return visit([](Entity& entity) { return &entity; });
+}
+
+inline const Entity* AnyEntity::get() const
+{
+    return visit([](const Entity& entity) { return &entity; });
+}
+
+inline Json AnyEntity::to_json() const
+{
+    return visit([](const Entity& entity) { return entity.to_json(); });
+}
+
+inline entity_ptr AnyEntity::to_ptr() const
+{
+    switch (type_)
+    {
+        case Entity::entity_t::request:
+            return make_entity<Request>(request_);
+        case Entity::entity_t::notification:
+            return make_entity<Notification>(notification_);
+        case Entity::entity_t::response:
+            return make_entity<Response>(response_);
+        case Entity::entity_t::batch:
+            return make_entity<Batch>(batch_);
+        case Entity::entity_t::error:
+            return make_entity<Error>(error_);
+        case Entity::entity_t::exception:
+            return make_entity<RequestException>(exception_);
+        default:
+            return nullptr;
+    }
+}
+
+
+//////////////////////// EntityPool implementation ////////////////////////////
+
+inline EntityPool::EntityPool(size_t max_size) : max_size_(max_size)
+{
+}
+
+template <>
+inline std::shared_ptr<Request> EntityPool::get<Request>()
+{
+    return get(requests_);
+}
+
+template <>
+inline std::shared_ptr<Notification> EntityPool::get<Notification>()
+{
+    return get(notifications_);
+}
+
+template <>
+inline std::shared_ptr<Response> EntityPool::get<Response>()
+{
+    return get(responses_);
+}
+
+template <>
+inline std::shared_ptr<Batch> EntityPool::get<Batch>()
+{
+    std::shared_ptr<Batch> batch = get(batches_);
+    batch->entities.clear();
+    return batch;
+}
+
+template <typename T, typename... Args>
+inline std::shared_ptr<T> EntityPool::make(Args&&... args)
+{
+    std::shared_ptr<T> entity = get<T>();
+    assign(*entity, 0, std::forward<Args>(args)...);
+    return entity;
+}
+
+template <typename T, typename... Args>
+inline auto EntityPool::assign(T& entity, int, Args&&... args) -> decltype(entity.assign(std::forward<Args>(args)...), void())
+{
+    entity.assign(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+inline void EntityPool::assign(T& entity, long, Args&&... args)
+{
+    entity = T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+inline std::shared_ptr<T> EntityPool::get(Slots<T>& slots)
+{
+    // round robin, starting behind the object that was handed out last
+    for (size_t n = 0; n < slots.items.size(); ++n)
+    {
+        size_t idx = (slots.next + n) % slots.items.size();
+        if (slots.items[idx].use_count() == 1)
+        {
+            slots.next = idx + 1;
+            return slots.items[idx];
+        }
+    }
+    // the pool's objects are always taken from the heap, see the class documentation
+    std::shared_ptr<T> entity = std::make_shared<T>();
+    if (slots.items.size() < max_size_)
+    {
+        slots.items.push_back(entity);
+        slots.next = slots.items.size();
+    }
+    return entity;
+}
+
+inline size_t EntityPool::size() const
+{
+    return requests_.items.size() + notifications_.items.size() + responses_.items.size() + batches_.items.size();
+}
+
+template <typename T>
+inline std::shared_ptr<T> EntityPool::acquire()
+{
+    EntityPool* pool = active();
+    if (pool != nullptr)
+        return pool->get<T>();
+    return make_entity<T>();
+}
+
+inline EntityPool*& EntityPool::active()
+{
+    static thread_local EntityPool* pool = nullptr;
+    return pool;
+}
+
+inline EntityPoolScope::EntityPoolScope(EntityPool* pool) : previous_(EntityPool::active())
+{
+    EntityPool::active() = pool;
+}
+
+inline EntityPoolScope::~EntityPoolScope()
+{
+    EntityPool::active() = previous_;
+}
+
+
+//////////////////////// ParamSchema implementation ///////////////////////////
+
+inline ParamSchema& ParamSchema::required(const std::string& name, type_t type)
+{
+    params_.push_back({name, type, true});
+    return *this;
+}
+
+inline ParamSchema& ParamSchema::optional(const std::string& name, type_t type)
+{
+    params_.push_back({name, type, false});
+    return *this;
+}
+
+inline ParamSchema& ParamSchema::strict(bool strict)
+{
+    strict_ = strict;
+    return *this;
+}
+
+inline std::string ParamSchema::check(const Parameter& params) const
+{
+    return check(params.value());
+}
+
+inline std::string ParamSchema::check(const Json& params) const
+{
+    std::string mismatch;
+    if (params.is_array())
+    {
+        for (size_t n = 0; (n < params_.size()) && mismatch.empty(); ++n)
+        {
+            if (n < params.size())
+                mismatch = check_value(params_[n], params[n]);
+            else if (params_[n].required)
+                mismatch = "missing parameter '" + params_[n].name + "'";
+        }
+        if (mismatch.empty() && strict_ && (params.size() > params_.size()))
+            mismatch = "too many parameters";
+    }
+    else if (params.is_object())
+    {
+        for (size_t n = 0; (n < params_.size()) && mismatch.empty(); ++n)
+        {
+            auto value = params.find(params_[n].name);
+            if (value != params.end())
+                mismatch = check_value(params_[n], *value);
+            else if (params_[n].required)
+                mismatch = "missing parameter '" + params_[n].name + "'";
+        }
+        if (mismatch.empty() && strict_)
+        {
+            for (auto it = params.begin(); it != params.end(); ++it)
+            {
+                std::string key(it.key().data(), it.key().size());
+                if (std::none_of(params_.begin(), params_.end(), [&key](const Param& param) { return param.name == key; }))
+                    return "unknown parameter '" + key + "'";
+            }
+        }
+    }
+    else
+    {
+        for (const auto& param : params_)
+        {
+            if (param.required)
+                return "missing parameter '" + param.name + "'";
+        }
+    }
+    return mismatch;
+}
+
+inline std::string ParamSchema::check_value(const Param& param, const Json& value) const
+{
+    if (matches(param.type, value))
+        return "";
+    return "parameter '" + param.name + "' must be " + type_str(param.type);
+}
+
+inline bool ParamSchema::matches(type_t type, const Json& value)
+{
+    switch (type)
+    {
+        case type_t::any:
+            return true;
+        case type_t::null:
+            return value.is_null();
+        case type_t::boolean:
+            return value.is_boolean();
+        case type_t::integer:
+            return value.is_number_integer();
+        case type_t::number:
+            return value.is_number();
+        case type_t::string:
+            return value.is_string();
+        case type_t::array:
+            return value.is_array();
+        case type_t::object:
+            return value.is_object();
+    }
+    return false;
+}
+
+inline std::string ParamSchema::type_str(type_t type)
+{
+    switch (type)
+    {
+        case type_t::any:
+            return "any";
+        case type_t::null:
+            return "null";
+        case type_t::boolean:
+            return "boolean";
+        case type_t::integer:
+            return "integer";
+        case type_t::number:
+            return "number";
+        case type_t::string:
+            return "string";
+        case type_t::array:
+            return "array";
+        case type_t::object:
+            return "object";
+    }
+    return "unknown";
+}
+
+
+//////////////////////// Parser implementation ////////////////////////////////
+
+inline void Parser::register_notification_callback(const std::string& notification, notification_callback callback)
+{
+    if (callback)
+        notification_callbacks_[notification] = callback;
+}
+
+inline void Parser::register_request_callback(const std::string& request, request_callback callback)
+{
+    if (callback)
+    {
+        request_callbacks_[request] = callback;
+        param_schemas_.erase(request);
+    }
+}
+
+inline void Parser::register_request_callback(const std::string& request, request_callback callback, ParamSchema schema)
+{
+    if (callback)
+    {
+        request_callbacks_[request] = callback;
+        param_schemas_[request] = std::move(schema);
+    }
+}
+
+inline entity_ptr Parser::parse(const std::string& json_str)
+{
+    return parse(json_str.data(), json_str.size());
+}
+
+inline entity_ptr Parser::parse(const char* json_str)
+{
+    return parse(json_str, strlen(json_str));
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+inline entity_ptr Parser::parse(std::string_view json_str)
+{
+    return parse(json_str.data(), json_str.size());
+}
+
+inline entity_ptr Parser::parse(const char* json_str, size_t size, std::pmr::memory_resource* resource)
+{
+    MemoryResourceScope scope(resource);
+    return parse(json_str, size);
+}
+#endif
+
+inline void Parser::set_lazy_params(bool lazy)
+{
+    lazy_params_ = lazy;
+}
+
+inline void Parser::set_entity_pool(std::shared_ptr<EntityPool> pool)
+{
+    entity_pool_ = std::move(pool);
+}
+
+inline void Parser::set_limits(const ParserLimits& limits)
+{
+    limits_ = limits;
+    limited_ = true;
+}
+
+inline entity_ptr Parser::parse(const char* json_str, size_t size)
+{
+    // std::cout << "parse: " << json_str << "\n";
+    EntityPoolScope scope(entity_pool_.get());
+    if (limited_)
+        return dispatch(do_parse(json_str, size, limits_));
+    return dispatch(lazy_params_ ? do_parse_lazy(json_str, size) : do_parse(json_str, size));
+}
+
+inline entity_ptr Parser::dispatch(const entity_ptr& entity)
+{
+    if (entity && entity->is_notification())
+    {
+        dispatch_notification(static_cast<const Notification&>(*entity));
+    }
+    else if (entity && entity->is_request())
+    {
+        response_ptr response = dispatch_request(static_cast<const Request&>(*entity));
+        if (response)
+            return response;
+    }
+    return entity;
+}
+
+inline AnyEntity Parser::dispatch(AnyEntity&& entity)
+{
+    if (entity.is_notification())
+    {
+        dispatch_notification(entity.as_notification());
+    }
+    else if (entity.is_request())
+    {
+        response_ptr response = dispatch_request(entity.as_request());
+        if (response)
+            return AnyEntity(*response);
+    }
+    return std::move(entity);
+}
+
+inline void Parser::dispatch_notification(const Notification& notification)
+{
+    auto iter = notification_callbacks_.find(notification.method());
+    if ((iter != notification_callbacks_.end()) && iter->second)
+        iter->second(notification.params());
+}
+
+inline response_ptr Parser::dispatch_request(const Request& request)
+{
+    auto iter = request_callbacks_.find(request.method());
+    if ((iter == request_callbacks_.end()) || !iter->second)
+        return nullptr;
+
+    auto schema = param_schemas_.find(request.method());
+    if (schema != param_schemas_.end())
+    {
+        std::string mismatch = schema->second.check(request.params());
+        if (!mismatch.empty())
+            throw InvalidParamsException(mismatch, request.id());
+    }
+    return iter->second(request.id(), request.params());
+}
+
+inline entity_ptr Parser::dispatch_element(const entity_ptr& entity)
+{
+    try
+    {
+        return dispatch(entity);
+    }
+    catch (const RequestException& e)
+    {
+        return make_entity<RequestException>(e);
+    }
+}
+
+inline ParseResult Parser::parse_streaming(const std::string& json_str, const streaming_callback& callback)
+{
+    return parse_streaming(json_str.data(), json_str.size(), callback);
+}
+
+inline ParseResult Parser::parse_streaming(const char* json_str, size_t size, const streaming_callback& callback)
+{
+    EntityPoolScope scope(entity_pool_.get());
+    EntitySaxHandler handler;
+    handler.set_limits(limits_);
+    handler.set_element_callback([this, &callback](const entity_ptr& element) { callback(dispatch_element(element), true); });
+    if (handler.check_size(size))
+        Json::sax_parse(json_str, json_str + size, &handler);
+    ParseResult result = handler.parse_result();
+    // a single message, the elements of a batch have been passed already
+    if (result && result.entity())
+    {
+        callback(dispatch_element(result.entity()), false);
+        return ParseResult();
+    }
+    return result;
+}
+
+inline AnyEntity Parser::parse_any(const std::string& json_str)
+{
+    return parse_any(json_str.data(), json_str.size());
+}
+
+inline AnyEntity Parser::parse_any(const char* json_str, size_t size)
+{
+    EntityPoolScope scope(entity_pool_.get());
+    return dispatch(do_parse_any(json_str, size, limits_));
+}
+
+inline entity_ptr Parser::parse_binary(const std::vector<uint8_t>& buffer, binary_format_t format)
+{
+    return parse_binary(buffer.data(), buffer.size(), format);
+}
+
+inline entity_ptr Parser::parse_binary(const uint8_t* data, size_t size, binary_format_t format)
+{
+    EntityPoolScope scope(entity_pool_.get());
+    return dispatch(do_parse_binary(data, size, format, limits_));
+}
+
+inline entity_ptr Parser::do_parse_binary(const std::vector<uint8_t>& buffer, binary_format_t format)
+{
+    return do_parse_binary(buffer.data(), buffer.size(), format);
+}
+
+inline entity_ptr Parser::do_parse_binary(const uint8_t* data, size_t size, binary_format_t format, const ParserLimits& limits)
+{
+    using input_format_t = nlohmann::detail::input_format_t;
+    input_format_t input_format = input_format_t::cbor;
+    switch (format)
+    {
+        case binary_format_t::cbor:
+            input_format = input_format_t::cbor;
+            break;
+        case binary_format_t::msgpack:
+            input_format = input_format_t::msgpack;
+            break;
+        case binary_format_t::ubjson:
+            input_format = input_format_t::ubjson;
+            break;
+        case binary_format_t::bjdata:
+            input_format = input_format_t::bjdata;
+            break;
+    }
+
+    try
+    {
+        EntitySaxHandler handler;
+        handler.set_limits(limits);
+        if (handler.check_size(size))
+            Json::sax_parse(data, data + size, &handler, input_format);
+        return handler.entity();
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+}
+
+inline AnyEntity Parser::do_parse_any(const std::string& json_str)
+{
+    return do_parse_any(json_str.data(), json_str.size());
+}
+
+inline AnyEntity Parser::do_parse_any(const char* json_str, size_t size, const ParserLimits& limits)
+{
+    try
+    {
+        EntitySaxHandler handler;
+        handler.set_limits(limits);
+        if (handler.check_size(size))
+            Json::sax_parse(json_str, json_str + size, &handler);
+        return handler.any_entity();
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+}
+
+inline entity_ptr Parser::parse_json(const Json& json)
+{
+    return do_parse_json(json);
+}
+
+inline entity_ptr Parser::do_parse(const std::string& json_str)
+{
+    return do_parse(json_str.data(), json_str.size());
+}
+
+inline entity_ptr Parser::do_parse(const char* json_str)
+{
+    return do_parse(json_str, strlen(json_str));
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+inline entity_ptr Parser::do_parse(std::string_view json_str)
+{
+    return do_parse(json_str.data(), json_str.size());
+}
+
+inline entity_ptr Parser::do_parse(const char* json_str, size_t size, std::pmr::memory_resource* resource)
+{
+    MemoryResourceScope scope(resource);
+    return do_parse(json_str, size);
+}
+#endif
+
+inline entity_ptr Parser::do_parse(const char* json_str, size_t size)
+{
+    return do_parse_with<default_json_traits>(json_str, size);
+}
+
+inline entity_ptr Parser::do_parse(const char* json_str, size_t size, const ParserLimits& limits)
+{
+    return do_try_parse(json_str, size, limits).value_or_throw();
+}
+
+template <typename Traits>
+inline entity_ptr Parser::do_parse_with(const char* json_str, size_t size)
+{
+    try
+    {
+        return Traits::parse(json_str, size);
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+    catch (...)
+    {
+        throw ParseErrorException("unknown parse error");
+    }
+}
+
+inline entity_ptr Parser::do_parse_lazy(const char* json_str, size_t size)
+{
+    try
+    {
+        return LazyParser::parse(json_str, size);
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+}
+
+#ifdef JSONRPCPP_USE_THREADS
+inline entity_ptr Parser::do_parse_parallel(const std::string& json_str, ThreadPool& pool)
+{
+    return do_parse_parallel(json_str.data(), json_str.size(), pool);
+}
+
+inline entity_ptr Parser::do_parse_parallel(const char* json_str, size_t size, ThreadPool& pool)
+{
+    try
+    {
+        return ParallelParser::parse(json_str, size, pool);
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw ParseErrorException(e.what());
+    }
+}
+#endif
+
+inline entity_ptr Parser::do_parse_json(const Json& json)
+{
+    try
+    {
+        if (json.is_object())
+            return do_parse_members(Members(json));
+        if (is_batch(json))
+        {
+            batch_ptr batch = EntityPool::acquire<Batch>();
+            batch->parse_json(json);
+            return batch;
+        }
+    }
+    catch (const RpcException&)
+    {
+        throw;
+    }
+    catch (const std::exception& e)
+    {
+        throw RpcException(e.what());
+    }
+
+    return nullptr;
+}
+
+inline entity_ptr Parser::do_parse_members(const Members& members)
+{
+    return do_try_parse_members(members).value_or_throw();
+}
+
+template <typename T>
+inline ParseResult Parser::try_parse_entity(const Members& members)
+{
+    std::shared_ptr<T> entity = EntityPool::acquire<T>();
+    ParseResult result = entity->try_parse_members(members);
+    if (!result)
+        return result;
+    return ParseResult(entity);
+}
+
+inline ParseResult Parser::do_try_parse_members(const Members& members)
+{
+    switch (members.type())
+    {
+        case Entity::entity_t::request:
+            return try_parse_entity<Request>(members);
+        case Entity::entity_t::notification:
+            return try_parse_entity<Notification>(members);
+        case Entity::entity_t::response:
+            return try_parse_entity<Response>(members);
+        default:
+            return ParseResult();
+    }
+}
+
+inline ParseResult Parser::do_try_parse(const std::string& json_str)
+{
+    return do_try_parse(json_str.data(), json_str.size());
+}
+
+inline ParseResult Parser::do_try_parse(const char* json_str, size_t size, const ParserLimits& limits)
+{
+    EntitySaxHandler handler;
+    handler.set_limits(limits);
+    if (handler.check_size(size))
+        Json::sax_parse(json_str, json_str + size, &handler);
+    return handler.parse_result();
+}
+
+inline ParseResult Parser::try_parse(const std::string& json_str)
+{
+    return try_parse(json_str.data(), json_str.size());
+}
+
+inline ParseResult Parser::try_parse(const char* json_str, size_t size)
+{
+    EntityPoolScope scope(entity_pool_.get());
+    ParseResult result;
+    if (lazy_params_ && !limited_)
+    {
+        try
+        {
+            result = ParseResult(do_parse_lazy(json_str, size));
+        }
+        catch (const ParseErrorException& e)
+        {
+            result = ParseResult(e);
+        }
+        catch (const RequestException& e)
+        {
+            result = ParseResult(e);
+        }
+        catch (const RpcException& e)
+        {
+            result = ParseResult(e);
+        }
+    }
+    else
+        result = do_try_parse(json_str, size, limits_);
+    if (!result)
+        return result;
+    try
+    {
+        return ParseResult(dispatch(result.entity()));
+    }
+    catch (const RequestException& e)
+    {
+        return ParseResult(e);
+    }
+    catch (const ParseErrorException& e)
+    {
+        // invalid lazy params, decoded by a callback
+        return ParseResult(e);
+    }
+}
+
+inline bool Parser::is_request(const std::string& json_str)
+{
+    return is_request(json_str.data(), json_str.size());
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+inline bool Parser::is_request(std::string_view json_str)
+{
+    return is_request(json_str.data(), json_str.size());
+}
+#endif
+
+inline bool Parser::is_request(const char* json_str, size_t size)
+{
+    try
+    {
+        return is_request(Json::parse(json_str, json_str + size));
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+inline bool Parser::is_request(const Json& json)
+{
+    return (Members(json).type() == Entity::entity_t::request);
+}
+
+inline bool Parser::is_notification(const std::string& json_str)
+{
+    return is_notification(json_str.data(), json_str.size());
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+inline bool Parser::is_notification(std::string_view json_str)
+{
+    return is_notification(json_str.data(), json_str.size());
+}
+#endif
+
+inline bool Parser::is_notification(const char* json_str, size_t size)
+{
+    try
+    {
+        return is_notification(Json::parse(json_str, json_str + size));
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
 
-class Response : public Entity
+inline bool Parser::is_notification(const Json& json)
 {
-public:
-    Response(const Json& json = nullptr);
-    Response(const Id& id, const Json& result);
-    Response(const Id& id, const Error& error);
-    Response(const Request& request, const Json& result);
-    Response(const Request& request, const Error& error);
-    Response(const RequestException& exception);
+    return (Members(json).type() == Entity::entity_t::notification);
+}
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+inline bool Parser::is_response(const std::string& json_str)
+{
+    return is_response(json_str.data(), json_str.size());
+}
 
-    const Id& id() const
-    {
-        return id_;
-    }
+#ifdef JSONRPCPP_HAS_CPP_17
+inline bool Parser::is_response(std::string_view json_str)
+{
+    return is_response(json_str.data(), json_str.size());
+}
+#endif
 
-    const Json& result() const
+inline bool Parser::is_response(const char* json_str, size_t size)
+{
+    try
     {
-        return result_;
+        return is_response(Json::parse(json_str, json_str + size));
     }
-
-    const Error& error() const
+    catch (const std::exception&)
     {
-        return error_;
+        return false;
     }
+}
 
-protected:
-    Id id_;
-    Json result_;
-    Error error_;
-};
-
+inline bool Parser::is_response(const Json& json)
+{
+    return (Members(json).type() == Entity::entity_t::response);
+}
 
-class Notification : public Entity
+inline bool Parser::is_batch(const std::string& json_str)
 {
-public:
-    Notification(const Json& json = nullptr);
-    Notification(const char* method, const Parameter& params = nullptr);
-    Notification(const std::string& method, const Parameter& params);
+    return is_batch(json_str.data(), json_str.size());
+}
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+#ifdef JSONRPCPP_HAS_CPP_17
+inline bool Parser::is_batch(std::string_view json_str)
+{
+    return is_batch(json_str.data(), json_str.size());
+}
+#endif
 
-    const std::string& method() const
+inline bool Parser::is_batch(const char* json_str, size_t size)
+{
+    try
     {
-        return method_;
+        return is_batch(Json::parse(json_str, json_str + size));
     }
-
-    const Parameter& params() const
+    catch (const std::exception&)
     {
-        return params_;
+        return false;
     }
+}
 
-protected:
-    std::string method_;
-    Parameter params_;
-};
+inline bool Parser::is_batch(const Json& json)
+{
+    return (json.is_array());
+}
 
 
-typedef std::function<void(const Parameter& params)> notification_callback;
-typedef std::function<jsonrpcpp::response_ptr(const Id& id, const Parameter& params)> request_callback;
+//////////////////////// JsonScanner implementation ///////////////////////////
 
-class Parser
+inline JsonScanner::JsonScanner(const char* first, const char* last) : first_(first), pos_(first), last_(last)
 {
-public:
-    Parser() = default;
-    virtual ~Parser() = default;
-
-    entity_ptr parse(const std::string& json_str);
-    entity_ptr parse_json(const Json& json);
-
-    void register_notification_callback(const std::string& notification, notification_callback callback);
-    void register_request_callback(const std::string& request, request_callback callback);
+}
 
-    static entity_ptr do_parse(const std::string& json_str);
-    static entity_ptr do_parse_json(const Json& json);
-    static bool is_request(const std::string& json_str);
-    static bool is_request(const Json& json);
-    static bool is_notification(const std::string& json_str);
-    static bool is_notification(const Json& json);
-    static bool is_response(const std::string& json_str);
-    static bool is_response(const Json& json);
-    static bool is_batch(const std::string& json_str);
-    static bool is_batch(const Json& json);
+inline void JsonScanner::skip_whitespace()
+{
+    while ((pos_ != last_) && ((*pos_ == ' ') || (*pos_ == '\n') || (*pos_ == '\r') || (*pos_ == '\t')))
+        ++pos_;
+}
 
-private:
-    std::map<std::string, notification_callback> notification_callbacks_;
-    std::map<std::string, request_callback> request_callbacks_;
-};
+inline char JsonScanner::peek()
+{
+    skip_whitespace();
+    return (pos_ != last_) ? *pos_ : '\0';
+}
 
+inline void JsonScanner::expect(char c)
+{
+    if (!consume(c))
+        error();
+}
 
-class Batch : public Entity
+inline bool JsonScanner::consume(char c)
 {
-public:
-    std::vector<entity_ptr> entities;
+    if (peek() != c)
+        return false;
+    ++pos_;
+    return true;
+}
 
-    Batch(const Json& json = nullptr);
+inline bool JsonScanner::at_end()
+{
+    skip_whitespace();
+    return (pos_ == last_);
+}
 
-    Json to_json() const override;
-    void parse_json(const Json& json) override;
+inline void JsonScanner::error() const
+{
+    if (pos_ == last_)
+        throw ParseErrorException("unexpected end of input");
+    throw ParseErrorException("unexpected character '" + std::string(1, *pos_) + "' at position " + std::to_string(pos_ - first_));
+}
 
-    template <typename T>
-    void add(const T& entity)
+inline void JsonScanner::skip_string()
+{
+    // pos_ is on the opening quote
+    for (++pos_; pos_ != last_; ++pos_)
     {
-        entities.push_back(std::make_shared<T>(entity));
+        if (*pos_ == '"')
+        {
+            ++pos_;
+            return;
+        }
+        if ((*pos_ == '\\') && (++pos_ == last_))
+            break;
     }
+    error();
+}
 
-    void add_ptr(const entity_ptr& entity)
+inline const char* JsonScanner::skip_value()
+{
+    char c = peek();
+    const char* begin = pos_;
+    if (c == '"')
     {
-        entities.push_back(entity);
+        skip_string();
+        return begin;
     }
-};
-
 
+    if ((c == '{') || (c == '['))
+    {
+        // expected closing brackets of the enclosing containers
+        std::string closing;
+        while (pos_ != last_)
+        {
+            c = *pos_;
+            if (c == '"')
+            {
+                skip_string();
+                continue;
+            }
+            if (c == '{')
+                closing.push_back('}');
+            else if (c == '[')
+                closing.push_back(']');
+            else if ((c == '}') || (c == ']'))
+            {
+                if (closing.back() != c)
+                    error();
+                closing.pop_back();
+                if (closing.empty())
+                {
+                    ++pos_;
+                    return begin;
+                }
+            }
+            ++pos_;
+        }
+        error();
+    }
 
-/////////////////////////// Entity implementation /////////////////////////////
+    // number, true, false or null
+    while ((pos_ != last_) && (std::strchr(",:]} \n\r\t{[\"", *pos_) == nullptr))
+        ++pos_;
+    if (pos_ == begin)
+        error();
+    return begin;
+}
 
-inline Entity::Entity(entity_t type) : entity(type)
+inline std::string JsonScanner::read_string()
 {
+    if (peek() != '"')
+        error();
+    const char* begin = pos_;
+    skip_string();
+    if (std::find(begin, pos_, '\\') == pos_)
+        return std::string(begin + 1, pos_ - 1);
+    return Json::parse(begin, pos_).get<std::string>();
 }
 
-inline bool Entity::is_exception() const
+
+//////////////////////// LazyParser implementation ////////////////////////////
+
+inline Members LazyParser::Message::members() const
 {
-    return (entity == entity_t::exception);
+    Members members;
+    members.jsonrpc = present[jsonrpc] ? &values[jsonrpc] : nullptr;
+    members.id = present[id] ? &values[id] : nullptr;
+    members.method = present[method] ? &values[method] : nullptr;
+    members.result = present[result] ? &values[result] : nullptr;
+    members.error = present[error] ? &values[error] : nullptr;
+    members.raw_params = params;
+    members.raw_params_size = params_size;
+    members.movable = true;
+    return members;
 }
 
-inline bool Entity::is_id() const
+inline void LazyParser::read_message(JsonScanner& scanner, Message& message)
 {
-    return (entity == entity_t::id);
+    static const char* const names[Message::member_count] = {"jsonrpc", "id", "method", "result", "error"};
+    for (size_t n = 0; n < Message::member_count; ++n)
+        message.present[n] = false;
+    message.params = nullptr;
+    message.params_size = 0;
+
+    scanner.expect('{');
+    if (scanner.consume('}'))
+        return;
+    do
+    {
+        std::string key = scanner.read_string();
+        scanner.expect(':');
+        const char* begin = scanner.skip_value();
+        if (key == "params")
+        {
+            message.params = begin;
+            message.params_size = static_cast<size_t>(scanner.position() - begin);
+            continue;
+        }
+        for (size_t n = 0; n < Message::member_count; ++n)
+        {
+            if (key == names[n])
+            {
+                message.values[n] = Json::parse(begin, scanner.position());
+                message.present[n] = true;
+                break;
+            }
+        }
+    } while (scanner.consume(','));
+    scanner.expect('}');
 }
 
-inline bool Entity::is_error() const
+inline entity_ptr LazyParser::parse(const char* json_str, size_t size)
 {
-    return (entity == entity_t::error);
+    JsonScanner scanner(json_str, json_str + size);
+    Message message;
+    entity_ptr entity(nullptr);
+    char c = scanner.peek();
+    if (c == '{')
+    {
+        read_message(scanner, message);
+        if (!scanner.at_end())
+            scanner.error();
+        entity = Parser::do_parse_members(message.members());
+    }
+    else if (c == '[')
+    {
+        batch_ptr batch = EntityPool::acquire<Batch>();
+        scanner.expect('[');
+        if (!scanner.consume(']'))
+        {
+            do
+            {
+                if (scanner.peek() == '{')
+                {
+                    read_message(scanner, message);
+                    ParseResult result = Parser::do_try_parse_members(message.members());
+                    // invalid JSON fails the whole batch, like with Parser::do_parse
+                    if (result.kind() == ParseResult::error_t::parse_error)
+                        result.throw_error();
+                    batch->add_ptr(Batch::to_element(result));
+                }
+                else
+                {
+                    const char* begin = scanner.skip_value();
+                    Json element = Json::parse(begin, scanner.position());
+                    batch->add_ptr(Batch::parse_element([&element]() { return Parser::do_parse_json(element); }));
+                }
+            } while (scanner.consume(','));
+            scanner.expect(']');
+        }
+        if (!scanner.at_end())
+            scanner.error();
+        if (batch->entities.empty())
+            throw InvalidRequestException();
+        entity = batch;
+    }
+    else
+    {
+        entity = Parser::do_parse_json(Json::parse(json_str, json_str + size));
+    }
+    return entity;
 }
 
-inline bool Entity::is_response() const
+
+#ifdef JSONRPCPP_USE_THREADS
+//////////////////////// ThreadPool implementation ////////////////////////////
+
+inline ThreadPool::ThreadPool(size_t threads) : stopped_(false)
 {
-    return (entity == entity_t::response);
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    workers_.reserve(threads);
+    for (size_t n = 0; n < threads; ++n)
+        workers_.emplace_back([this]() { run(); });
 }
 
-inline bool Entity::is_request() const
+inline ThreadPool::~ThreadPool()
 {
-    return (entity == entity_t::request);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    condition_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
 }
 
-inline bool Entity::is_notification() const
+inline void ThreadPool::post(std::function<void()> task)
 {
-    return (entity == entity_t::notification);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    condition_.notify_one();
 }
 
-inline bool Entity::is_batch() const
+inline void ThreadPool::run()
 {
-    return (entity == entity_t::batch);
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+            if (tasks_.empty())
+                return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
 }
 
-inline void Entity::parse(const char* json_str)
+
+//////////////////////// ParallelParser implementation ////////////////////////
+
+inline entity_ptr ParallelParser::parse(const char* json_str, size_t size, ThreadPool& pool)
 {
-    // http://www.jsonrpc.org/specification
-    //	code	message	meaning
-    //	-32700	Parse error	Invalid JSON was received by the server. An error occurred on the server while parsing the JSON text.
-    //	-32600	Invalid Request	The JSON sent is not a valid Request object.
-    //	-32601	Method not found	The method does not exist / is not available.
-    //	-32602	Invalid params	Invalid method parameter(s).
-    //	-32603	Internal error	Internal JSON-RPC error.
-    //	-32000 to -32099	Server error	Reserved for implementation-defined server-errors.
+    JsonScanner scanner(json_str, json_str + size);
+    if (scanner.peek() != '[')
+        return Parser::do_parse(json_str, size);
+
+    std::vector<Element> elements;
+    scanner.expect('[');
+    if (!scanner.consume(']'))
+    {
+        do
+        {
+            const char* begin = scanner.skip_value();
+            elements.push_back({begin, scanner.position()});
+        } while (scanner.consume(','));
+        scanner.expect(']');
+    }
+    if (!scanner.at_end())
+        scanner.error();
+    if (elements.empty())
+        throw InvalidRequestException();
+
+    // the calling thread parses the first chunk
+    size_t chunks = std::min(pool.size() + 1, (elements.size() + min_elements - 1) / min_elements);
+    size_t chunk = (elements.size() + chunks - 1) / chunks;
+    chunks = (elements.size() + chunk - 1) / chunk;
+
+    std::vector<entity_ptr> entities(elements.size());
+    std::vector<std::exception_ptr> errors(chunks);
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t running = 0;
+    for (size_t n = 1; n < chunks; ++n)
+    {
+        size_t first = n * chunk;
+        size_t last = std::min(first + chunk, elements.size());
+        std::exception_ptr& error = errors[n];
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++running;
+        }
+        try
+        {
+            pool.post([&elements, &entities, &error, &mutex, &finished, &running, first, last]() {
+                try
+                {
+                    parse_range(elements.data() + first, elements.data() + last, entities.data() + first);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0)
+                    finished.notify_one();
+            });
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            break;
+        }
+    }
     try
     {
-        parse_json(Json::parse(json_str));
+        parse_range(elements.data(), elements.data() + chunk, entities.data());
     }
-    catch (const RpcException&)
+    catch (...)
     {
-        throw;
+        errors[0] = std::current_exception();
     }
-    catch (const std::exception& e)
     {
-        throw ParseErrorException(e.what());
+        // the tasks refer to this stack frame
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&running]() { return running == 0; });
+    }
+    for (const auto& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
     }
+
+    batch_ptr batch = EntityPool::acquire<Batch>();
+    batch->entities = std::move(entities);
+    return batch;
 }
 
-inline void Entity::parse(const std::string& json_str)
+inline void ParallelParser::parse_range(const Element* first, const Element* last, entity_ptr* out)
 {
-    parse(json_str.c_str());
+    for (; first != last; ++first, ++out)
+        *out = parse_element(*first);
 }
 
-inline std::string Entity::type_str() const
+inline entity_ptr ParallelParser::parse_element(const Element& element)
 {
-    switch (entity)
+    if (*element.begin == '{')
     {
-        case entity_t::unknown:
-            return "unknown";
-        case entity_t::id:
-            return "id";
-        case entity_t::exception:
-            return "exception";
-        case entity_t::error:
-            return "error";
-        case entity_t::response:
-            return "response";
-        case entity_t::request:
-            return "request";
-        case entity_t::notification:
-            return "notification";
-        case entity_t::batch:
-            return "batch";
-        default:
-            return "unknown";
+        ParseResult result = Parser::do_try_parse(element.begin, static_cast<size_t>(element.end - element.begin));
+        // invalid JSON fails the whole batch, like with Parser::do_parse
+        if (result.kind() == ParseResult::error_t::parse_error)
+            result.throw_error();
+        return Batch::to_element(result);
     }
+    Json json = Json::parse(element.begin, element.end);
+    return Batch::parse_element([&json]() { return Parser::do_parse_json(json); });
 }
+#endif
 
 
-/////////////////////////// NullableEntity implementation /////////////////////
+#ifdef JSONRPCPP_USE_SIMDJSON
+//////////////////////// SimdjsonParser implementation ////////////////////////
 
-inline NullableEntity::NullableEntity(entity_t type) : Entity(type), isNull(false)
+inline Members SimdjsonParser::Message::members() const
+{
+    Members members;
+    members.jsonrpc = present[jsonrpc] ? &values[jsonrpc] : nullptr;
+    members.id = present[id] ? &values[id] : nullptr;
+    members.method = present[method] ? &values[method] : nullptr;
+    members.params = present[params] ? &values[params] : nullptr;
+    members.result = present[result] ? &values[result] : nullptr;
+    members.error = present[error] ? &values[error] : nullptr;
+    members.movable = true;
+    return members;
+}
+
+inline Json SimdjsonParser::to_json(simdjson::ondemand::value value)
 {
+    switch (value.type())
+    {
+        case simdjson::ondemand::json_type::object:
+        {
+            Json json = Json::object();
+            for (simdjson::ondemand::field field : value.get_object())
+            {
+                std::string_view key = field.unescaped_key();
+                json[std::string(key)] = to_json(field.value());
+            }
+            return json;
+        }
+        case simdjson::ondemand::json_type::array:
+        {
+            Json json = Json::array();
+            for (simdjson::ondemand::value element : value.get_array())
+                json.push_back(to_json(element));
+            return json;
+        }
+        case simdjson::ondemand::json_type::string:
+        {
+            std::string_view str = value.get_string();
+            return std::string(str);
+        }
+        case simdjson::ondemand::json_type::number:
+        {
+            switch (value.get_number_type())
+            {
+                case simdjson::ondemand::number_type::signed_integer:
+                    return static_cast<int64_t>(value.get_int64());
+                case simdjson::ondemand::number_type::unsigned_integer:
+                    return static_cast<uint64_t>(value.get_uint64());
+                case simdjson::ondemand::number_type::floating_point_number:
+                    return static_cast<double>(value.get_double());
+                default:
+                {
+                    // integers beyond 64 bit: let nlohmann decide, like the default parser does
+                    std::string_view token = value.raw_json_token();
+                    return Json::parse(token.data(), token.data() + token.size());
+                }
+            }
+        }
+        case simdjson::ondemand::json_type::boolean:
+            return static_cast<bool>(value.get_bool());
+        case simdjson::ondemand::json_type::null:
+            if (!value.is_null())
+                throw ParseErrorException("invalid literal");
+            return nullptr;
+        default:
+            throw ParseErrorException("invalid value");
+    }
 }
 
-inline NullableEntity::NullableEntity(entity_t type, std::nullptr_t) : Entity(type), isNull(true)
+inline void SimdjsonParser::check(simdjson::ondemand::value value)
 {
+    switch (value.type())
+    {
+        case simdjson::ondemand::json_type::object:
+            for (simdjson::ondemand::field field : value.get_object())
+            {
+                if (field.unescaped_key().error() != simdjson::SUCCESS)
+                    throw ParseErrorException("invalid object key");
+                check(field.value());
+            }
+            break;
+        case simdjson::ondemand::json_type::array:
+            for (simdjson::ondemand::value element : value.get_array())
+                check(element);
+            break;
+        default:
+            // scalars are cheap to convert
+            to_json(value);
+            break;
+    }
 }
 
-
-/////////////////////////// Id implementation /////////////////////////////////
-
-inline Id::Id() : Entity(entity_t::id), type_(value_t::null), int_id_(0), string_id_("")
+inline void SimdjsonParser::read_message(simdjson::ondemand::object object, Message& message)
 {
-}
+    static const char* const names[Message::member_count] = {"jsonrpc", "id", "method", "params", "result", "error"};
+    for (size_t n = 0; n < Message::member_count; ++n)
+        message.present[n] = false;
 
-inline Id::Id(int id) : Entity(entity_t::id), type_(value_t::integer), int_id_(id), string_id_("")
-{
+    for (simdjson::ondemand::field field : object)
+    {
+        std::string_view key = field.unescaped_key();
+        size_t n = 0;
+        while ((n < Message::member_count) && (key != names[n]))
+            ++n;
+        if (n == Message::member_count)
+        {
+            // On-Demand would skip the value without validating it
+            check(field.value());
+            continue;
+        }
+        message.values[n] = to_json(field.value());
+        message.present[n] = true;
+    }
 }
 
-inline Id::Id(const char* id) : Entity(entity_t::id), type_(value_t::string), int_id_(0), string_id_(id)
+inline entity_ptr SimdjsonParser::parse(const char* json_str, size_t size)
 {
+    // grows to the largest message, so that only the copy is left per message
+    static thread_local std::vector<char> buffer;
+    if (buffer.size() < size + simdjson::SIMDJSON_PADDING)
+        buffer.resize(size + simdjson::SIMDJSON_PADDING);
+    memcpy(buffer.data(), json_str, size);
+    memset(buffer.data() + size, 0, simdjson::SIMDJSON_PADDING);
+    return parse(buffer.data(), size, buffer.size());
 }
 
-inline Id::Id(const std::string& id) : Id(id.c_str())
+inline entity_ptr SimdjsonParser::parse(const char* json_str, size_t size, size_t capacity)
 {
+    if (capacity < size + simdjson::SIMDJSON_PADDING)
+        return parse(json_str, size);
+    // the parser keeps its buffers between calls
+    static thread_local simdjson::ondemand::parser parser;
+    simdjson::ondemand::document document = parser.iterate(json_str, size, capacity);
+    Message message;
+    entity_ptr entity(nullptr);
+    switch (document.type())
+    {
+        case simdjson::ondemand::json_type::object:
+        {
+            read_message(document.get_object(), message);
+            if (!document.at_end())
+                throw ParseErrorException("unexpected content after the message");
+            entity = Parser::do_parse_members(message.members());
+            break;
+        }
+        case simdjson::ondemand::json_type::array:
+        {
+            batch_ptr batch = EntityPool::acquire<Batch>();
+            for (simdjson::ondemand::value element : document.get_array())
+            {
+                // elements are read before parse_element, so that malformed JSON fails the whole batch
+                if (element.type() == simdjson::ondemand::json_type::object)
+                {
+                    read_message(element.get_object(), message);
+                    Members members = message.members();
+                    batch->add_ptr(Batch::to_element(Parser::do_try_parse_members(members)));
+                }
+                else
+                {
+                    Json json = to_json(element);
+                    batch->add_ptr(Batch::parse_element([&json]() { return Parser::do_parse_json(json); }));
+                }
+            }
+            if (!document.at_end())
+                throw ParseErrorException("unexpected content after the batch");
+            if (batch->entities.empty())
+                throw InvalidRequestException();
+            entity = batch;
+            break;
+        }
+        default:
+            entity = Parser::do_parse_json(Json::parse(json_str, json_str + size));
+            break;
+    }
+    return entity;
 }
+#endif
 
-inline Id::Id(const Json& json_id) : Id()
-{
-    Id::parse_json(json_id);
-}
 
-inline void Id::parse_json(const Json& json)
+//////////////////////// JSON backends implementation /////////////////////////
+
+inline entity_ptr nlohmann_traits::parse(const char* json_str, size_t size)
 {
-    if (json.is_null())
-    {
-        type_ = value_t::null;
-    }
-    else if (json.is_number_integer())
-    {
-        int_id_ = json.get<int>();
-        type_ = value_t::integer;
-    }
-    else if (json.is_string())
-    {
-        string_id_ = json.get<std::string>();
-        type_ = value_t::string;
-    }
-    else
-        throw std::invalid_argument("id must be integer, string or null");
+    return Parser::do_try_parse(json_str, size).value_or_throw();
 }
 
-inline Json Id::to_json() const
+#ifdef JSONRPCPP_USE_SIMDJSON
+inline entity_ptr simdjson_traits::parse(const char* json_str, size_t size)
 {
-    if (type_ == value_t::null)
-        return nullptr;
-    if (type_ == value_t::string)
-        return string_id_;
-    if (type_ == value_t::integer)
-        return int_id_;
-
-    return nullptr;
+    return SimdjsonParser::parse(json_str, size);
 }
+#endif
 
 
-//////////////////////// Error implementation /////////////////////////////////
+//////////////////////// EntitySaxHandler implementation //////////////////////
 
-inline Parameter::Parameter(std::nullptr_t) : NullableEntity(entity_t::id, nullptr), type(value_t::null)
+inline EntitySaxHandler::EntitySaxHandler()
+    : state_(state_t::document), in_batch_(false), present_(), target_(nullptr), skip_depth_(0), object_element_(nullptr), batch_(nullptr), batch_size_(0)
 {
 }
 
-inline Parameter::Parameter(const Json& json) : NullableEntity(entity_t::id), type(value_t::null)
+inline bool EntitySaxHandler::null()
 {
-    if (json != nullptr)
-        Parameter::parse_json(json);
+    return count_value() && add_value(Json(nullptr));
 }
 
-inline Parameter::Parameter(const std::string& key1, const Json& value1, const std::string& key2, const Json& value2, const std::string& key3,
-                            const Json& value3, const std::string& key4, const Json& value4)
-    : NullableEntity(entity_t::id), type(value_t::map)
+inline bool EntitySaxHandler::boolean(bool val)
 {
-    param_map[key1] = value1;
-    if (!key2.empty())
-        add(key2, value2);
-    if (!key3.empty())
-        add(key3, value3);
-    if (!key4.empty())
-        add(key4, value4);
+    return count_value() && add_value(Json(val));
 }
 
-inline void Parameter::add(const std::string& key, const Json& value)
+inline bool EntitySaxHandler::number_integer(Json::number_integer_t val)
 {
-    param_map[key] = value;
+    return count_value() && add_value(Json(val));
 }
 
-inline void Parameter::parse_json(const Json& json)
+inline bool EntitySaxHandler::number_unsigned(Json::number_unsigned_t val)
 {
-    if (json.is_null())
-    {
-        param_array.clear();
-        param_map.clear();
-        type = value_t::null;
-        isNull = true;
-    }
-    else if (json.is_array())
-    {
-        param_array = json.get<std::vector<Json>>();
-        param_map.clear();
-        type = value_t::array;
-    }
-    else
-    {
-        param_map = json.get<std::map<std::string, Json>>();
-        param_array.clear();
-        type = value_t::map;
-    }
+    return count_value() && add_value(Json(val));
 }
 
-inline Json Parameter::to_json() const
+inline bool EntitySaxHandler::number_float(Json::number_float_t val, const Json::string_t& /*s*/)
 {
-    if (type == value_t::array)
-        return param_array;
-    if (type == value_t::map)
-        return param_map;
-
-    return nullptr;
+    return count_value() && add_value(Json(val));
 }
 
-inline bool Parameter::is_array() const
+inline bool EntitySaxHandler::string(Json::string_t& val)
 {
-    return type == value_t::array;
+    return count_value() && check_string(val) && add_value(Json(std::move(val)));
 }
 
-inline bool Parameter::is_map() const
+inline bool EntitySaxHandler::binary(Json::binary_t& val)
 {
-    return type == value_t::map;
+    if (val.size() > limits_.max_string_length)
+        return exceeded("max_string_length");
+    return count_value() && add_value(Json(std::move(val)));
 }
 
-inline bool Parameter::is_null() const
+inline bool EntitySaxHandler::start_object(std::size_t /*elements*/)
 {
-    return type == value_t::null;
+    if (!count_value() || !enter_container())
+        return false;
+    if (!stack_.empty() || (skip_depth_ > 0) || (state_ == state_t::member_value))
+        return start_container(Json(Json::value_t::object));
+
+    // a message, either the document itself or an element of a batch
+    begin_message();
+    return true;
 }
 
-inline bool Parameter::has(const std::string& key) const
+inline bool EntitySaxHandler::key(Json::string_t& val)
 {
-    if (type != value_t::map)
+    if (!check_string(val))
         return false;
-    return (param_map.find(key) != param_map.end());
+    if (skip_depth_ > 0)
+        return true;
+    if (!stack_.empty())
+    {
+        object_element_ = &(*stack_.back())[val];
+        return true;
+    }
+
+    // member of a message
+    state_ = state_t::member_value;
+    target_ = nullptr;
+    static const char* const names[member_count] = {"jsonrpc", "id", "method", "params", "result", "error"};
+    for (size_t n = 0; n < member_count; ++n)
+    {
+        if (val == names[n])
+        {
+            target_ = &values_[n];
+            present_[n] = true;
+            break;
+        }
+    }
+    return true;
 }
 
-inline Json Parameter::get(const std::string& key) const
+inline bool EntitySaxHandler::end_object()
 {
-    return param_map.at(key);
+    leave_container();
+    if (!stack_.empty() || (skip_depth_ > 0))
+        return end_container();
+
+    // end of a message
+    if (in_batch_)
+    {
+        Members members = this->members();
+        add_element(Batch::to_element(Parser::do_try_parse_members(members)));
+        state_ = state_t::batch_element;
+    }
+    else
+    {
+        state_ = state_t::done;
+    }
+    return true;
 }
 
-inline bool Parameter::has(size_t idx) const
+inline bool EntitySaxHandler::start_array(std::size_t /*elements*/)
 {
-    if (type != value_t::array)
+    if (!count_value() || !enter_container())
         return false;
-    return (param_array.size() > idx);
+    if (state_ == state_t::document)
+    {
+        in_batch_ = true;
+        batch_ = EntityPool::acquire<Batch>();
+        state_ = state_t::batch_element;
+        return true;
+    }
+    return start_container(Json(Json::value_t::array));
 }
 
-inline Json Parameter::get(size_t idx) const
+inline bool EntitySaxHandler::end_array()
 {
-    return param_array.at(idx);
-}
-
-
-//////////////////////// Error implementation /////////////////////////////////
+    leave_container();
+    if (!stack_.empty() || (skip_depth_ > 0))
+        return end_container();
 
-inline Error::Error(const Json& json) : Error("Internal error", -32603, nullptr)
-{
-    if (json != nullptr)
-        Error::parse_json(json);
+    // end of a batch
+    state_ = state_t::done;
+    return true;
 }
 
-inline Error::Error(std::nullptr_t) : NullableEntity(entity_t::error, nullptr), code_(0), message_(""), data_(nullptr)
+inline bool EntitySaxHandler::parse_error(std::size_t /*position*/, const std::string& /*last_token*/, const nlohmann::detail::exception& ex)
 {
+    // reported by parse_result(), parsing stops here
+    parse_error_ = ex.what();
+    state_ = state_t::failed;
+    return false;
 }
 
-inline Error::Error(const std::string& message, int code, const Json& data) : NullableEntity(entity_t::error), code_(code), message_(message), data_(data)
+inline entity_ptr EntitySaxHandler::entity()
 {
+    return parse_result().value_or_throw();
 }
 
-inline void Error::parse_json(const Json& json)
+inline ParseResult EntitySaxHandler::parse_result()
 {
-    try
-    {
-        if (json.count("code") == 0)
-            throw RpcException("code is missing");
-        code_ = json["code"];
-        if (json.count("message") == 0)
-            throw RpcException("message is missing");
-        message_ = json["message"].get<std::string>();
-        if (json.count("data") != 0u)
-            data_ = json["data"];
-        else
-            data_ = nullptr;
-    }
-    catch (const RpcException&)
+    if (state_ == state_t::failed)
+        return ParseErrorException(parse_error_);
+    if (state_ == state_t::limit_exceeded)
+        return InvalidRequestException(parse_error_);
+    if (state_ != state_t::done)
+        return ParseResult();
+
+    if (in_batch_)
     {
-        throw;
+        if (batch_size_ == 0)
+            return InvalidRequestException();
+        if (element_callback_)
+            return ParseResult();
+        return ParseResult(batch_);
     }
-    catch (const std::exception& e)
+    return Parser::do_try_parse_members(members());
+}
+
+inline AnyEntity EntitySaxHandler::any_entity()
+{
+    if (state_ == state_t::failed)
+        throw ParseErrorException(parse_error_);
+    if (state_ == state_t::limit_exceeded)
+        throw InvalidRequestException(parse_error_);
+    if (state_ != state_t::done)
+        return AnyEntity();
+
+    if (in_batch_)
     {
-        throw RpcException(e.what());
+        if (batch_size_ == 0)
+            throw InvalidRequestException();
+        if (element_callback_)
+            return AnyEntity();
+        return AnyEntity(std::move(*batch_));
     }
+    return AnyEntity::from_members(members());
 }
 
-inline Json Error::to_json() const
+inline void EntitySaxHandler::set_element_callback(element_callback callback)
 {
-    Json j = {{"code", code_}, {"message", message_}};
-
-    if (!data_.is_null())
-        j["data"] = data_;
-    return j;
+    element_callback_ = std::move(callback);
 }
 
-
-////////////////////// Request implementation /////////////////////////////////
-
-inline Request::Request(const Json& json) : Entity(entity_t::request), method_(""), id_()
+inline void EntitySaxHandler::set_limits(const ParserLimits& limits)
 {
-    if (json != nullptr)
-        Request::parse_json(json);
+    limits_ = limits;
 }
 
-inline Request::Request(const Id& id, const std::string& method, const Parameter& params) : Entity(entity_t::request), method_(method), params_(params), id_(id)
+inline bool EntitySaxHandler::check_size(size_t size)
 {
+    if (size > limits_.max_size)
+        return exceeded("max_size");
+    return true;
 }
 
-inline void Request::parse_json(const Json& json)
+inline bool EntitySaxHandler::count_value()
 {
-    try
-    {
-        if (json.count("id") == 0)
-            throw InvalidRequestException("id is missing");
-
-        try
-        {
-            id_ = Id(json["id"]);
-        }
-        catch (const std::exception& e)
-        {
-            throw InvalidRequestException(e.what());
-        }
-
-        if (json.count("jsonrpc") == 0)
-            throw InvalidRequestException("jsonrpc is missing", id_);
-        std::string jsonrpc = json["jsonrpc"].get<std::string>();
-        if (jsonrpc != "2.0")
-            throw InvalidRequestException("invalid jsonrpc value: " + jsonrpc, id_);
-
-        if (json.count("method") == 0)
-            throw InvalidRequestException("method is missing", id_);
-        if (!json["method"].is_string())
-            throw InvalidRequestException("method must be a string value", id_);
-        method_ = json["method"].get<std::string>();
-        if (method_.empty())
-            throw InvalidRequestException("method must not be empty", id_);
-
-        if (json.count("params") != 0u)
-            params_.parse_json(json["params"]);
-        else
-            params_ = nullptr;
-    }
-    catch (const RequestException&)
+    if (sizes_.empty())
+        return true;
+    size_t& size = sizes_.back();
+    ++size;
+    if ((sizes_.size() == 1) && in_batch_)
     {
-        throw;
+        if (size > limits_.max_batch_size)
+            return exceeded("max_batch_size");
     }
-    catch (const std::exception& e)
+    else if (size > limits_.max_array_size)
     {
-        throw InternalErrorException(e.what(), id_);
+        return exceeded("max_array_size");
     }
+    return true;
 }
 
-inline Json Request::to_json() const
+inline bool EntitySaxHandler::enter_container()
 {
-    Json json = {{"jsonrpc", "2.0"}, {"method", method_}, {"id", id_.to_json()}};
-
-    if (params_)
-        json["params"] = params_.to_json();
-
-    return json;
+    if (sizes_.size() >= limits_.max_depth)
+        return exceeded("max_depth");
+    sizes_.push_back(0);
+    return true;
 }
 
-
-inline RpcException::RpcException(const char* text) : m_(text)
+inline void EntitySaxHandler::leave_container()
 {
+    sizes_.pop_back();
 }
 
-inline RpcException::RpcException(const std::string& text) : RpcException(text.c_str())
+inline bool EntitySaxHandler::check_string(const Json::string_t& val)
 {
+    if (val.size() > limits_.max_string_length)
+        return exceeded("max_string_length");
+    return true;
 }
 
-inline const char* RpcException::what() const noexcept
+inline bool EntitySaxHandler::exceeded(const std::string& limit)
 {
-    return m_.what();
+    // reported by parse_result(), parsing stops here
+    parse_error_ = "limit exceeded: " + limit;
+    state_ = state_t::limit_exceeded;
+    return false;
 }
 
-
-inline RpcEntityException::RpcEntityException(const Error& error) : RpcException(error.message()), Entity(entity_t::exception), error_(error)
+inline void EntitySaxHandler::add_element(const entity_ptr& element)
 {
+    ++batch_size_;
+    if (element_callback_)
+        element_callback_(element);
+    else
+        batch_->add_ptr(element);
 }
 
-inline void RpcEntityException::parse_json(const Json& /*json*/)
+inline void EntitySaxHandler::begin_message()
 {
+    for (size_t n = 0; n < member_count; ++n)
+        present_[n] = false;
+    state_ = state_t::member_key;
 }
 
-
-inline ParseErrorException::ParseErrorException(const Error& error) : RpcEntityException(error)
+inline Members EntitySaxHandler::members() const
 {
+    Members members;
+    members.jsonrpc = present_[jsonrpc] ? &values_[jsonrpc] : nullptr;
+    members.id = present_[id] ? &values_[id] : nullptr;
+    members.method = present_[method] ? &values_[method] : nullptr;
+    members.params = present_[params] ? &values_[params] : nullptr;
+    members.result = present_[result] ? &values_[result] : nullptr;
+    members.error = present_[error] ? &values_[error] : nullptr;
+    members.movable = true;
+    return members;
 }
 
-inline ParseErrorException::ParseErrorException(const std::string& data) : ParseErrorException(Error("Parse error", -32700, data))
+inline void EntitySaxHandler::value_done()
 {
+    if (state_ == state_t::member_value)
+    {
+        state_ = state_t::member_key;
+    }
+    else if (state_ == state_t::batch_element)
+    {
+        // batch element that is not an object
+        const Json& element = element_;
+        add_element(Batch::parse_element([&element]() { return Parser::do_parse_json(element); }));
+    }
+    else if (state_ == state_t::document)
+    {
+        // neither a message nor a batch
+        state_ = state_t::done;
+    }
 }
 
-inline Json ParseErrorException::to_json() const
+inline bool EntitySaxHandler::add_value(Json&& value)
 {
-    Json response = {{"jsonrpc", "2.0"}, {"error", error_.to_json()}, {"id", nullptr}};
+    if (skip_depth_ > 0)
+        return true;
 
-    return response;
-}
+    if (!stack_.empty())
+    {
+        Json& parent = *stack_.back();
+        if (parent.is_array())
+            parent.push_back(std::move(value));
+        else
+            *object_element_ = std::move(value);
+        return true;
+    }
 
+    if (state_ == state_t::member_value)
+    {
+        if (target_ != nullptr)
+            *target_ = std::move(value);
+    }
+    else if (state_ == state_t::batch_element)
+    {
+        element_ = std::move(value);
+    }
+    value_done();
+    return true;
+}
 
-inline RequestException::RequestException(const Error& error, const Id& requestId) : RpcEntityException(error), id_(requestId)
+inline bool EntitySaxHandler::start_container(Json&& container)
 {
+    if (skip_depth_ > 0)
+    {
+        ++skip_depth_;
+        return true;
+    }
+
+    Json* value = nullptr;
+    if (!stack_.empty())
+    {
+        Json& parent = *stack_.back();
+        if (parent.is_array())
+        {
+            parent.push_back(std::move(container));
+            value = &parent.back();
+        }
+        else
+        {
+            *object_element_ = std::move(container);
+            value = object_element_;
+        }
+    }
+    else if (state_ == state_t::member_value)
+    {
+        if (target_ == nullptr)
+        {
+            // unknown member, don't materialize the value
+            skip_depth_ = 1;
+            return true;
+        }
+        *target_ = std::move(container);
+        value = target_;
+    }
+    else
+    {
+        // batch element that is not an object
+        element_ = std::move(container);
+        value = &element_;
+    }
+    stack_.push_back(value);
+    return true;
 }
 
-inline Json RequestException::to_json() const
+inline bool EntitySaxHandler::end_container()
 {
-    Json response = {{"jsonrpc", "2.0"}, {"error", error_.to_json()}, {"id", id_.to_json()}};
+    if (skip_depth_ > 0)
+    {
+        if (--skip_depth_ == 0)
+            value_done();
+        return true;
+    }
 
-    return response;
+    stack_.pop_back();
+    if (stack_.empty())
+        value_done();
+    return true;
 }
 
 
-inline InvalidRequestException::InvalidRequestException(const Id& requestId) : RequestException(Error("Invalid request", -32600), requestId)
+//////////////////////// StreamDecoder implementation /////////////////////////
+
+inline StreamDecoder::StreamDecoder(result_callback callback, size_t max_size)
+    : parser_(nullptr), callback_(std::move(callback)), max_size_(max_size), depth_(0), in_string_(false), escape_(false), skipping_(false)
 {
 }
 
-inline InvalidRequestException::InvalidRequestException(const Request& request) : InvalidRequestException(request.id())
+inline StreamDecoder::StreamDecoder(Parser& parser, result_callback callback, size_t max_size) : StreamDecoder(std::move(callback), max_size)
 {
+    parser_ = &parser;
 }
 
-inline InvalidRequestException::InvalidRequestException(const char* data, const Id& requestId)
-    : RequestException(Error("Invalid request", -32600, data), requestId)
+inline void StreamDecoder::feed(const std::string& data)
 {
+    feed(data.data(), data.size());
 }
 
-inline InvalidRequestException::InvalidRequestException(const std::string& data, const Id& requestId) : InvalidRequestException(data.c_str(), requestId)
+inline void StreamDecoder::feed(const char* data)
 {
+    feed(data, strlen(data));
 }
 
-
-inline MethodNotFoundException::MethodNotFoundException(const Id& requestId) : RequestException(Error("Method not found", -32601), requestId)
+#ifdef JSONRPCPP_HAS_CPP_17
+inline void StreamDecoder::feed(std::string_view data)
 {
+    feed(data.data(), data.size());
 }
+#endif
 
-inline MethodNotFoundException::MethodNotFoundException(const Request& request) : MethodNotFoundException(request.id())
+inline void StreamDecoder::feed(const char* data, size_t size)
 {
+    const char* pos = data;
+    const char* last = data + size;
+    while (pos != last)
+    {
+        if (depth_ == 0)
+        {
+            // between messages
+            char c = *pos;
+            if ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r'))
+            {
+                ++pos;
+                continue;
+            }
+            if ((c != '{') && (c != '['))
+            {
+                callback_(ParseErrorException("unexpected character '" + std::string(1, c) + "' between messages"));
+                ++pos;
+                continue;
+            }
+        }
+
+        const char* begin = pos;
+        const char* end = scan(pos, last);
+        if (skipping_)
+        {
+            if (end == nullptr)
+                return;
+            skipping_ = false;
+            pos = end;
+            continue;
+        }
+        if (buffer_.size() + static_cast<size_t>((end == nullptr ? last : end) - begin) > max_size_)
+        {
+            callback_(ParseErrorException("message exceeds the maximum size of " + std::to_string(max_size_) + " bytes"));
+            buffer_.clear();
+            if (end == nullptr)
+            {
+                skipping_ = true;
+                return;
+            }
+            pos = end;
+            continue;
+        }
+        if (end == nullptr)
+        {
+            buffer_.append(begin, last);
+            return;
+        }
+        if (buffer_.empty())
+        {
+            emit(begin, static_cast<size_t>(end - begin));
+        }
+        else
+        {
+            buffer_.append(begin, end);
+            emit(buffer_.data(), buffer_.size());
+            buffer_.clear();
+        }
+        pos = end;
+    }
 }
 
-inline MethodNotFoundException::MethodNotFoundException(const char* data, const Id& requestId)
-    : RequestException(Error("Method not found", -32601, data), requestId)
+inline void StreamDecoder::reset()
 {
+    buffer_.clear();
+    depth_ = 0;
+    in_string_ = false;
+    escape_ = false;
+    skipping_ = false;
 }
 
-inline MethodNotFoundException::MethodNotFoundException(const std::string& data, const Id& requestId) : MethodNotFoundException(data.c_str(), requestId)
+inline const char* StreamDecoder::scan(const char* pos, const char* last)
 {
+    for (; pos != last; ++pos)
+    {
+        char c = *pos;
+        if (in_string_)
+        {
+            if (escape_)
+                escape_ = false;
+            else if (c == '\\')
+                escape_ = true;
+            else if (c == '"')
+                in_string_ = false;
+            continue;
+        }
+        switch (c)
+        {
+            case '"':
+                in_string_ = true;
+                break;
+            case '{':
+            case '[':
+                ++depth_;
+                break;
+            case '}':
+            case ']':
+                if (--depth_ == 0)
+                    return pos + 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return nullptr;
 }
 
-
-inline InvalidParamsException::InvalidParamsException(const Id& requestId) : RequestException(Error("Invalid params", -32602), requestId)
+inline void StreamDecoder::emit(const char* json_str, size_t size)
 {
+    if (parser_ != nullptr)
+        callback_(parser_->try_parse(json_str, size));
+    else
+        callback_(Parser::do_try_parse(json_str, size));
 }
 
-inline InvalidParamsException::InvalidParamsException(const Request& request) : InvalidParamsException(request.id())
-{
-}
 
-inline InvalidParamsException::InvalidParamsException(const char* data, const Id& requestId)
-    : RequestException(Error("Invalid params", -32602, data), requestId)
+//////////////////////// NdjsonCodec implementation ///////////////////////////
+
+#if defined(JSONRPCPP_HAS_SSE2) || defined(JSONRPCPP_HAS_NEON)
+/// Index of the lowest set bit, bits must not be 0
+inline unsigned count_trailing_zeros(uint64_t bits)
 {
+#ifdef _MSC_VER
+    unsigned long idx;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64(&idx, bits);
+#else
+    if (_BitScanForward(&idx, static_cast<unsigned long>(bits)) == 0)
+    {
+        _BitScanForward(&idx, static_cast<unsigned long>(bits >> 32));
+        idx += 32;
+    }
+#endif
+    return static_cast<unsigned>(idx);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
 }
+#endif
 
-inline InvalidParamsException::InvalidParamsException(const std::string& data, const Id& requestId) : InvalidParamsException(data.c_str(), requestId)
+inline void append_json(const Json& json, std::string& out)
 {
+    nlohmann::detail::serializer<Json> serializer(nlohmann::detail::output_adapter<char, std::string>(out), ' ');
+    serializer.dump(json, false, false, 0);
 }
 
-
-inline InternalErrorException::InternalErrorException(const Id& requestId) : RequestException(Error("Internal error", -32603), requestId)
+inline const char* find_newline(const char* first, const char* last)
 {
+#ifdef JSONRPCPP_HAS_AVX2
+    const __m256i newline32 = _mm256_set1_epi8('\n');
+    while (last - first >= 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline32)));
+        if (mask != 0)
+            return first + count_trailing_zeros(mask);
+        first += 32;
+    }
+#endif
+#if defined(JSONRPCPP_HAS_SSE2)
+    const __m128i newline16 = _mm_set1_epi8('\n');
+    while (last - first >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline16)));
+        if (mask != 0)
+            return first + count_trailing_zeros(mask);
+        first += 16;
+    }
+#elif defined(JSONRPCPP_HAS_NEON)
+    const uint8x16_t newline16 = vdupq_n_u8('\n');
+    while (last - first >= 16)
+    {
+        uint8x16_t matches = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(first)), newline16);
+        // matching bytes are 0xff, the lowest one of each half gives the position
+        uint64x2_t halves = vreinterpretq_u64_u8(matches);
+        uint64_t low = vgetq_lane_u64(halves, 0);
+        if (low != 0)
+            return first + count_trailing_zeros(low) / 8;
+        uint64_t high = vgetq_lane_u64(halves, 1);
+        if (high != 0)
+            return first + 8 + count_trailing_zeros(high) / 8;
+        first += 16;
+    }
+#endif
+    while ((first != last) && (*first != '\n'))
+        ++first;
+    return first;
 }
 
-inline InternalErrorException::InternalErrorException(const Request& request) : InternalErrorException(request.id())
+inline NdjsonCodec::NdjsonCodec(result_callback callback, size_t max_size)
+    : parser_(nullptr), callback_(std::move(callback)), max_size_(max_size), skipping_(false)
 {
 }
 
-inline InternalErrorException::InternalErrorException(const char* data, const Id& requestId)
-    : RequestException(Error("Internal error", -32603, data), requestId)
+inline NdjsonCodec::NdjsonCodec(Parser& parser, result_callback callback, size_t max_size) : NdjsonCodec(std::move(callback), max_size)
 {
+    parser_ = &parser;
 }
 
-inline InternalErrorException::InternalErrorException(const std::string& data, const Id& requestId) : InternalErrorException(data.c_str(), requestId)
+inline void NdjsonCodec::feed(const std::string& data)
 {
+    feed(data.data(), data.size());
 }
 
-
-///////////////////// Response implementation /////////////////////////////////
-
-inline Response::Response(const Json& json) : Entity(entity_t::response)
+inline void NdjsonCodec::feed(const char* data)
 {
-    if (json != nullptr)
-        Response::parse_json(json);
+    feed(data, strlen(data));
 }
 
-inline Response::Response(const Id& id, const Json& result) : Entity(entity_t::response), id_(id), result_(result), error_(nullptr)
+#ifdef JSONRPCPP_HAS_CPP_17
+inline void NdjsonCodec::feed(std::string_view data)
 {
+    feed(data.data(), data.size());
 }
+#endif
 
-inline Response::Response(const Id& id, const Error& error) : Entity(entity_t::response), id_(id), result_(), error_(error)
+inline void NdjsonCodec::feed(const char* data, size_t size)
 {
+    const char* pos = data;
+    const char* last = data + size;
+    while (pos != last)
+    {
+        const char* newline = find_newline(pos, last);
+        if (skipping_)
+        {
+            if (newline == last)
+                return;
+            skipping_ = false;
+            pos = newline + 1;
+            continue;
+        }
+        if (buffer_.size() + static_cast<size_t>(newline - pos) > max_size_)
+        {
+            callback_(ParseErrorException("message exceeds the maximum size of " + std::to_string(max_size_) + " bytes"));
+            buffer_.clear();
+            if (newline == last)
+            {
+                skipping_ = true;
+                return;
+            }
+            pos = newline + 1;
+            continue;
+        }
+        if (newline == last)
+        {
+            buffer_.append(pos, last);
+            return;
+        }
+        if (buffer_.empty())
+        {
+            emit(pos, newline);
+        }
+        else
+        {
+            buffer_.append(pos, newline);
+            emit(buffer_.data(), buffer_.data() + buffer_.size());
+            buffer_.clear();
+        }
+        pos = newline + 1;
+    }
 }
 
-inline Response::Response(const Request& request, const Json& result) : Response(request.id(), result)
+inline void NdjsonCodec::finish()
 {
+    skipping_ = false;
+    if (buffer_.empty())
+        return;
+    emit(buffer_.data(), buffer_.data() + buffer_.size());
+    buffer_.clear();
 }
 
-inline Response::Response(const Request& request, const Error& error) : Response(request.id(), error)
+inline void NdjsonCodec::reset()
 {
+    buffer_.clear();
+    skipping_ = false;
 }
 
-inline Response::Response(const RequestException& exception) : Response(exception.id(), exception.error())
+inline void NdjsonCodec::emit(const char* first, const char* last)
 {
+    // skip empty lines
+    const char* begin = first;
+    while ((begin != last) && ((*begin == ' ') || (*begin == '\t') || (*begin == '\r')))
+        ++begin;
+    if (begin == last)
+        return;
+    if (*(last - 1) == '\r')
+        --last;
+
+    size_t size = static_cast<size_t>(last - first);
+    if (parser_ != nullptr)
+        callback_(parser_->try_parse(first, size));
+    else
+        callback_(Parser::do_try_parse(first, size));
 }
 
-inline void Response::parse_json(const Json& json)
+inline void NdjsonCodec::encode(const Entity& entity, std::string& out)
 {
-    try
-    {
-        error_ = nullptr;
-        result_ = nullptr;
-        if (json.count("jsonrpc") == 0)
-            throw RpcException("jsonrpc is missing");
-        std::string jsonrpc = json["jsonrpc"].get<std::string>();
-        if (jsonrpc != "2.0")
-            throw RpcException("invalid jsonrpc value: " + jsonrpc);
-        if (json.count("id") == 0)
-            throw RpcException("id is missing");
-        id_ = Id(json["id"]);
-        if (json.count("result") != 0u)
-            result_ = json["result"];
-        else if (json.count("error") != 0u)
-            error_ = json["error"];
-        else
-            throw RpcException("response must contain result or error");
-    }
-    catch (const RpcException&)
-    {
-        throw;
-    }
-    catch (const std::exception& e)
-    {
-        throw RpcException(e.what());
-    }
+    size_t start = out.size();
+    entity.append_to(out);
+    // serialized strings have their newlines escaped, others are whitespace of raw JSON
+    const char* last = out.data() + out.size();
+    for (const char* pos = find_newline(out.data() + start, last); pos != last; pos = find_newline(pos + 1, last))
+        out[static_cast<size_t>(pos - out.data())] = ' ';
+    out.push_back('\n');
 }
 
-inline Json Response::to_json() const
+inline void NdjsonCodec::encode(const Json& json, std::string& out)
 {
-    Json j = {{"jsonrpc", "2.0"}, {"id", id_.to_json()}};
-
-    if (error_)
-        j["error"] = error_.to_json();
-    else
-        j["result"] = result_;
-
-    return j;
+    append_json(json, out);
+    out.push_back('\n');
 }
 
 
-///////////////// Notification implementation /////////////////////////////////
-
-inline Notification::Notification(const Json& json) : Entity(entity_t::notification)
-{
-    if (json != nullptr)
-        Notification::parse_json(json);
-}
+//////////////////////// ContentLengthCodec implementation ////////////////////
 
-inline Notification::Notification(const char* method, const Parameter& params) : Entity(entity_t::notification), method_(method), params_(params)
+inline ContentLengthCodec::ContentLengthCodec(result_callback callback, size_t max_size)
+    : parser_(nullptr), callback_(std::move(callback)), max_size_(max_size), prepared_(0), scanned_(0), header_size_(0), content_length_(0), skip_(0),
+      digits_(3)
 {
 }
 
-inline Notification::Notification(const std::string& method, const Parameter& params) : Notification(method.c_str(), params)
+inline ContentLengthCodec::ContentLengthCodec(Parser& parser, result_callback callback, size_t max_size)
+    : ContentLengthCodec(std::move(callback), max_size)
 {
+    parser_ = &parser;
 }
 
-inline void Notification::parse_json(const Json& json)
+inline void ContentLengthCodec::feed(const std::string& data)
 {
-    try
-    {
-        if (json.count("jsonrpc") == 0)
-            throw RpcException("jsonrpc is missing");
-        std::string jsonrpc = json["jsonrpc"].get<std::string>();
-        if (jsonrpc != "2.0")
-            throw RpcException("invalid jsonrpc value: " + jsonrpc);
-
-        if (json.count("method") == 0)
-            throw RpcException("method is missing");
-        if (!json["method"].is_string())
-            throw RpcException("method must be a string value");
-        method_ = json["method"].get<std::string>();
-        if (method_.empty())
-            throw RpcException("method must not be empty");
-
-        if (json.count("params") != 0u)
-            params_.parse_json(json["params"]);
-        else
-            params_ = nullptr;
-    }
-    catch (const RpcException&)
-    {
-        throw;
-    }
-    catch (const std::exception& e)
-    {
-        throw RpcException(e.what());
-    }
+    feed(data.data(), data.size());
 }
 
-inline Json Notification::to_json() const
+inline void ContentLengthCodec::feed(const char* data)
 {
-    Json json = {{"jsonrpc", "2.0"}, {"method", method_}};
-
-    if (params_)
-        json["params"] = params_.to_json();
-
-    return json;
+    feed(data, strlen(data));
 }
 
-
-//////////////////////// Batch implementation /////////////////////////////////
-
-inline Batch::Batch(const Json& json) : Entity(entity_t::batch)
+#ifdef JSONRPCPP_HAS_CPP_17
+inline void ContentLengthCodec::feed(std::string_view data)
 {
-    if (json != nullptr)
-        Batch::parse_json(json);
+    feed(data.data(), data.size());
 }
+#endif
 
-inline void Batch::parse_json(const Json& json)
+inline void ContentLengthCodec::feed(const char* data, size_t size)
 {
-    //	cout << "Batch::parse: " << json.dump() << "\n";
-    entities.clear();
-    for (const auto& it : json)
+    if (!input_.empty())
     {
-        //		cout << "x: " << it->dump() << "\n";
-        entity_ptr entity(nullptr);
-        try
-        {
-            entity = Parser::do_parse_json(it);
-            if (!entity)
-                entity = std::make_shared<Error>("Invalid Request", -32600);
-        }
-        catch (const RequestException& e)
-        {
-            entity = std::make_shared<RequestException>(e);
-        }
-        catch (const std::exception& e)
-        {
-            entity = std::make_shared<Error>(e.what(), -32600);
-        }
-        entities.push_back(entity);
+        input_.append(data, size);
+        decode_input();
+        return;
     }
-    if (entities.empty())
-        throw InvalidRequestException();
+    size_t consumed = decode(data, size);
+    if (consumed == size)
+        return;
+    input_.append(data + consumed, size - consumed);
 }
 
-inline Json Batch::to_json() const
+inline char* ContentLengthCodec::prepare(size_t size)
 {
-    Json result;
-    for (const auto& j : entities)
-        result.push_back(j->to_json());
-    return result;
+    prepared_ = input_.size();
+    input_.resize(prepared_ + size);
+    return &input_[prepared_];
 }
 
+inline void ContentLengthCodec::commit(size_t size)
+{
+    input_.resize(prepared_ + size);
+    decode_input();
+}
 
-//////////////////////// Parser implementation ////////////////////////////////
-
-inline void Parser::register_notification_callback(const std::string& notification, notification_callback callback)
+inline void ContentLengthCodec::reset()
 {
-    if (callback)
-        notification_callbacks_[notification] = callback;
+    input_.clear();
+    scanned_ = 0;
+    header_size_ = 0;
+    content_length_ = 0;
+    skip_ = 0;
 }
 
-inline void Parser::register_request_callback(const std::string& request, request_callback callback)
+inline void ContentLengthCodec::decode_input()
 {
-    if (callback)
-        request_callbacks_[request] = callback;
+    size_t consumed = decode(input_.data(), input_.size());
+    input_.erase(0, consumed);
 }
 
-inline entity_ptr Parser::parse(const std::string& json_str)
+inline size_t ContentLengthCodec::decode(const char* data, size_t size)
 {
-    // std::cout << "parse: " << json_str << "\n";
-    entity_ptr entity = do_parse(json_str);
-    if (entity && entity->is_notification())
+    static const char separator[] = "\r\n\r\n";
+    size_t consumed = 0;
+    while (consumed < size)
     {
-        notification_ptr notification = std::dynamic_pointer_cast<jsonrpcpp::Notification>(entity);
-        if (notification_callbacks_.find(notification->method()) != notification_callbacks_.end())
+        const char* frame = data + consumed;
+        size_t available = size - consumed;
+        if (skip_ != 0)
+        {
+            size_t skipped = std::min(skip_, available);
+            skip_ -= skipped;
+            consumed += skipped;
+            continue;
+        }
+        if (header_size_ == 0)
         {
-            notification_callback callback = notification_callbacks_[notification->method()];
-            if (callback)
-                callback(notification->params());
+            // the separator may start in the part that was searched already
+            size_t start = (scanned_ > 3) ? scanned_ - 3 : 0;
+            const char* end = std::search(frame + start, frame + available, separator, separator + 4);
+            if (end == frame + available)
+            {
+                if (available > max_size_)
+                {
+                    callback_(ParseErrorException("header exceeds the maximum size of " + std::to_string(max_size_) + " bytes"));
+                    scanned_ = 0;
+                    return size;
+                }
+                scanned_ = available;
+                return consumed;
+            }
+            header_size_ = static_cast<size_t>(end - frame) + 4;
+            scanned_ = 0;
+            if (!parse_header(frame, end))
+            {
+                callback_(ParseErrorException("invalid header: Content-Length is missing or invalid"));
+                consumed += header_size_;
+                header_size_ = 0;
+                continue;
+            }
+            if (content_length_ > max_size_)
+            {
+                callback_(ParseErrorException("Content-Length " + std::to_string(content_length_) + " exceeds the maximum size of " +
+                                              std::to_string(max_size_) + " bytes"));
+                consumed += header_size_;
+                header_size_ = 0;
+                skip_ = content_length_;
+                continue;
+            }
         }
+        if (available - header_size_ < content_length_)
+            return consumed;
+        emit(frame + header_size_, content_length_);
+        consumed += header_size_ + content_length_;
+        header_size_ = 0;
     }
-    else if (entity && entity->is_request())
+    return consumed;
+}
+
+inline bool ContentLengthCodec::parse_header(const char* first, const char* last)
+{
+    static const char name[] = "content-length";
+    static const size_t name_size = sizeof(name) - 1;
+    static const char crlf[] = "\r\n";
+    bool found = false;
+    while (first < last)
     {
-        request_ptr request = std::dynamic_pointer_cast<jsonrpcpp::Request>(entity);
-        if (request_callbacks_.find(request->method()) != request_callbacks_.end())
+        const char* line_end = std::search(first, last, crlf, crlf + 2);
+        const char* colon = std::find(first, line_end, ':');
+        if ((colon != line_end) && (static_cast<size_t>(colon - first) == name_size) &&
+            std::equal(first, colon, name, [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; }))
         {
-            request_callback callback = request_callbacks_[request->method()];
-            if (callback)
+            const char* pos = colon + 1;
+            while ((pos != line_end) && ((*pos == ' ') || (*pos == '\t')))
+                ++pos;
+            if ((pos == line_end) || (*pos < '0') || (*pos > '9'))
+                return false;
+            size_t length = 0;
+            for (; (pos != line_end) && (*pos >= '0') && (*pos <= '9'); ++pos)
             {
-                jsonrpcpp::response_ptr response = callback(request->id(), request->params());
-                if (response)
-                    return response;
+                if (length > (std::numeric_limits<size_t>::max() - 9) / 10)
+                    return false;
+                length = length * 10 + static_cast<size_t>(*pos - '0');
             }
+            while ((pos != line_end) && ((*pos == ' ') || (*pos == '\t')))
+                ++pos;
+            if (pos != line_end)
+                return false;
+            content_length_ = length;
+            found = true;
         }
+        first = (line_end == last) ? last : line_end + 2;
     }
-    return entity;
+    return found;
 }
 
-inline entity_ptr Parser::parse_json(const Json& json)
+inline void ContentLengthCodec::emit(const char* json_str, size_t size)
 {
-    return do_parse_json(json);
+    if (parser_ != nullptr)
+        callback_(parser_->try_parse(json_str, size));
+    else
+        callback_(Parser::do_try_parse(json_str, size));
 }
 
-inline entity_ptr Parser::do_parse(const std::string& json_str)
+inline void ContentLengthCodec::encode(const Entity& entity, std::string& out)
 {
-    try
-    {
-        return do_parse_json(Json::parse(json_str));
-    }
-    catch (const RpcException&)
-    {
-        throw;
-    }
-    catch (const std::exception& e)
-    {
-        throw ParseErrorException(e.what());
-    }
-    catch (...)
-    {
-        return nullptr;
-    }
+    encode_with(out, [&entity](std::string& message) { entity.append_to(message); });
 }
 
-inline entity_ptr Parser::do_parse_json(const Json& json)
+inline void ContentLengthCodec::encode(const Json& json, std::string& out)
 {
-    try
-    {
-        if (is_request(json))
-            return std::make_shared<Request>(json);
-        if (is_notification(json))
-            return std::make_shared<Notification>(json);
-        if (is_response(json))
-            return std::make_shared<Response>(json);
-        if (is_batch(json))
-            return std::make_shared<Batch>(json);
-    }
-    catch (const RpcException&)
-    {
-        throw;
-    }
-    catch (const std::exception& e)
-    {
-        throw RpcException(e.what());
-    }
+    encode_with(out, [&json](std::string& message) { append_json(json, message); });
+}
 
-    return nullptr;
+template <typename Serialize>
+inline void ContentLengthCodec::encode_with(std::string& out, const Serialize& serialize)
+{
+    static const char prefix[] = "Content-Length: ";
+    static const size_t prefix_size = sizeof(prefix) - 1;
+    size_t start = out.size();
+    size_t header_size = prefix_size + digits_ + 4;
+    out.resize(start + header_size);
+    serialize(out);
+    std::string length = std::to_string(out.size() - start - header_size);
+    if (length.size() > digits_)
+        out.insert(start + header_size, length.size() - digits_, ' ');
+    else if (length.size() < digits_)
+        out.erase(start + header_size - (digits_ - length.size()), digits_ - length.size());
+    digits_ = length.size();
+
+    char* header = &out[start];
+    memcpy(header, prefix, prefix_size);
+    memcpy(header + prefix_size, length.data(), length.size());
+    memcpy(header + prefix_size + length.size(), "\r\n\r\n", 4);
 }
 
-inline bool Parser::is_request(const std::string& json_str)
+
+//////////////////////// BatchWriter implementation ///////////////////////////
+
+inline BatchWriter::BatchWriter(chunk_callback sink, size_t chunk_size) : sink_(std::move(sink)), chunk_size_(chunk_size), size_(0)
 {
-    try
-    {
-        return is_request(Json::parse(json_str));
-    }
-    catch (const std::exception&)
-    {
-        return false;
-    }
 }
 
-inline bool Parser::is_request(const Json& json)
+inline void BatchWriter::add(const entity_ptr& entity)
 {
-    return ((json.count("method") != 0u) && (json.count("id") != 0u));
+    if (entity)
+        add(*entity);
 }
 
-inline bool Parser::is_notification(const std::string& json_str)
+inline void BatchWriter::add(const Entity& entity)
 {
-    try
-    {
-        return is_notification(Json::parse(json_str));
-    }
-    catch (const std::exception&)
+    buffer_.push_back((size_ == 0) ? '[' : ',');
+    if (!append_reply(entity))
     {
-        return false;
+        buffer_.pop_back();
+        return;
     }
+    ++size_;
+    if (buffer_.size() >= chunk_size_)
+        flush();
 }
 
-inline bool Parser::is_notification(const Json& json)
+inline void BatchWriter::write(const entity_ptr& entity)
 {
-    return ((json.count("method") != 0u) && (json.count("id") == 0));
+    if (entity)
+        write(*entity);
 }
 
-inline bool Parser::is_response(const std::string& json_str)
+inline void BatchWriter::write(const Entity& entity)
 {
-    try
-    {
-        return is_response(Json::parse(json_str));
-    }
-    catch (const std::exception&)
-    {
-        return false;
-    }
+    if (append_reply(entity))
+        flush();
 }
 
-inline bool Parser::is_response(const Json& json)
+inline bool BatchWriter::append_reply(const Entity& entity)
 {
-    return (((json.count("result") != 0u) || (json.count("error") != 0u)) && (json.count("id") != 0u));
+    if (entity.is_response() || entity.is_exception())
+        entity.append_to(buffer_);
+    else if (entity.is_error())
+        Response(Id(), static_cast<const Error&>(entity)).append_to(buffer_);
+    else if (entity.is_request())
+        MethodNotFoundException(static_cast<const Request&>(entity)).append_to(buffer_);
+    else
+        return false;
+    return true;
 }
 
-inline bool Parser::is_batch(const std::string& json_str)
+inline void BatchWriter::finish()
 {
-    try
-    {
-        return is_batch(Json::parse(json_str));
-    }
-    catch (const std::exception&)
-    {
-        return false;
-    }
+    if (size_ == 0)
+        return;
+    buffer_.push_back(']');
+    flush();
+    size_ = 0;
 }
 
-inline bool Parser::is_batch(const Json& json)
+inline void BatchWriter::flush()
 {
-    return (json.is_array());
+    if (buffer_.empty())
+        return;
+    sink_(buffer_.data(), buffer_.size());
+    buffer_.clear();
 }
 
 } // namespace jsonrpcpp
 
+
+namespace std
+{
+template <>
+struct hash<jsonrpcpp::Id>
+{
+    size_t operator()(const jsonrpcpp::Id& id) const
+    {
+        return id.hash();
+    }
+};
+} // namespace std
+
 #endif
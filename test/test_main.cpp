@@ -9,6 +9,9 @@
 // local headers
 #include "jsonrpcpp.hpp"
 
+// standard headers
+#include <unordered_map>
+
 // 3rd party headers
 #include <catch2/catch_test_macros.hpp>
 
@@ -45,4 +48,1258 @@ TEST_CASE("Null parameter")
     REQUIRE(response.id().int_id() == 4);
     REQUIRE(response.result() == 12);
     REQUIRE(response.to_json() == nlohmann::json::parse(R"({"jsonrpc": "2.0", "result": 12, "id": 4})"));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Single pass parser")
+{
+    std::vector<std::string> messages = {
+        R"({"jsonrpc": "2.0", "method": "subtract", "params": {"subtrahend": 23, "minuend": [42, {"a": [1.5, null, true]}]}, "foo": {"bar": [1, 2]}, "id": 3})",
+        R"({"jsonrpc": "2.0", "method": "update", "params": [1, 2, 3, 4, 5]})",
+        R"({"jsonrpc": "2.0", "result": {"a": "b"}, "id": "x"})",
+        R"({"jsonrpc": "2.0", "error": {"code": -32601, "message": "Method not found"}, "id": "1"})",
+        R"([{"jsonrpc": "2.0", "method": "sum", "params": [1,2,4], "id": "1"}, 1, [2], {"foo": "boo"}, {"jsonrpc": "2.0", "method": 1, "params": "bar", "id": 4}])"};
+    for (const auto& message : messages)
+    {
+        jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse(message);
+        jsonrpcpp::entity_ptr dom_entity = jsonrpcpp::Parser::do_parse_json(Json::parse(message));
+        REQUIRE(entity);
+        REQUIRE(entity->type_str() == dom_entity->type_str());
+        REQUIRE(entity->to_json() == dom_entity->to_json());
+    }
+
+    REQUIRE(jsonrpcpp::Parser::do_parse(R"({"foo": "boo"})") == nullptr);
+    REQUIRE(jsonrpcpp::Parser::do_parse(R"(42)") == nullptr);
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse(R"({"jsonrpc": "2.0", "method": 1} x)"), jsonrpcpp::ParseErrorException);
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse(R"({"jsonrpc": "2.0", "method": "foo", "id": 1.5})"), jsonrpcpp::InvalidRequestException);
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse(R"([])"), jsonrpcpp::InvalidRequestException);
+}
+
+
+TEST_CASE("Message classification")
+{
+    Json request = Json::parse(R"({"jsonrpc": "2.0", "method": "foo", "result": 1, "id": 1})");
+    REQUIRE(jsonrpcpp::Parser::is_request(request));
+    REQUIRE(!jsonrpcpp::Parser::is_notification(request));
+    REQUIRE(!jsonrpcpp::Parser::is_response(request));
+
+    Json notification = Json::parse(R"({"jsonrpc": "2.0", "method": "foo"})");
+    REQUIRE(jsonrpcpp::Parser::is_notification(notification));
+
+    Json response = Json::parse(R"({"jsonrpc": "2.0", "error": {"code": 1, "message": "foo"}, "id": null})");
+    REQUIRE(jsonrpcpp::Parser::is_response(response));
+    REQUIRE(jsonrpcpp::Members(response).type() == jsonrpcpp::Entity::entity_t::response);
+
+    REQUIRE(jsonrpcpp::Members(Json::parse(R"({"result": 1})")).type() == jsonrpcpp::Entity::entity_t::unknown);
+    REQUIRE(jsonrpcpp::Members(Json::parse(R"([1, 2])")).type() == jsonrpcpp::Entity::entity_t::unknown);
+    REQUIRE(jsonrpcpp::Parser::do_parse_json(Json::parse(R"("foo")")) == nullptr);
+}
+
+
+TEST_CASE("Parse from buffer")
+{
+    // frame followed by the start of the next one, not NUL-terminated
+    const std::string buffer = R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 7}{"jsonrpc": "2.0", "met)";
+    const char* frame = buffer.data();
+    size_t size = buffer.find('}') + 1;
+
+    jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse(frame, size);
+    REQUIRE(entity->is_request());
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Request>(entity)->id().int_id() == 7);
+    REQUIRE(jsonrpcpp::Parser::is_request(frame, size));
+    REQUIRE(!jsonrpcpp::Parser::is_request(frame, size + 1));
+
+    jsonrpcpp::Request request;
+    request.parse(frame, size);
+    REQUIRE(request.method() == "sum");
+
+    jsonrpcpp::Parser parser;
+    REQUIRE(parser.parse(frame, size)->is_request());
+    REQUIRE_THROWS_AS(parser.parse(frame, size + 10), jsonrpcpp::ParseErrorException);
+
+#ifdef JSONRPCPP_HAS_CPP_17
+    std::string_view view(frame, size);
+    REQUIRE(jsonrpcpp::Parser::do_parse(view)->is_request());
+    REQUIRE(jsonrpcpp::Parser::is_request(view));
+#endif
+}
+
+
+TEST_CASE("Lazy parameters")
+{
+    const std::string message = R"({"jsonrpc": "2.0", "method": "subtract", "params": {"subtrahend": 23, "minuend": [42, "]"]}, "id": 3})";
+    jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse_lazy(message.data(), message.size());
+    REQUIRE(entity->is_request());
+    jsonrpcpp::request_ptr request = dynamic_pointer_cast<jsonrpcpp::Request>(entity);
+    REQUIRE(request->params().is_map());
+    REQUIRE(request->params().is_raw());
+    REQUIRE(request->params().raw() == R"({"subtrahend": 23, "minuend": [42, "]"]})");
+    // the text is referenced, not copied
+    REQUIRE(request->params().raw_data() == message.data() + message.find("{\"subtrahend"));
+    REQUIRE(request->params().get<int>("subtrahend") == 23);
+    REQUIRE(!request->params().is_raw());
+    REQUIRE(request->to_json() == jsonrpcpp::Parser::do_parse(message)->to_json());
+
+    const std::string batch = R"([{"jsonrpc": "2.0", "method": "update", "params": [1, 2]}, {"foo": "boo"}, 1, {"jsonrpc": "2.0", "method": "x", "params": null, "id": 1}])";
+    entity = jsonrpcpp::Parser::do_parse_lazy(batch.data(), batch.size());
+    REQUIRE(entity->is_batch());
+    REQUIRE(entity->to_json() == jsonrpcpp::Parser::do_parse(batch)->to_json());
+
+    // scalar params fail only their batch element, like with do_parse
+    const std::string scalar = R"([{"jsonrpc": "2.0", "method": "x", "params": 5, "id": 1}, {"jsonrpc": "2.0", "method": "update", "params": "a"}, )"
+                               R"({"jsonrpc": "2.0", "method": "x", "params": [5], "id": 2}])";
+    entity = jsonrpcpp::Parser::do_parse_lazy(scalar.data(), scalar.size());
+    REQUIRE(entity->is_batch());
+    jsonrpcpp::batch_ptr lazy_batch = dynamic_pointer_cast<jsonrpcpp::Batch>(entity);
+    REQUIRE(lazy_batch->entities.size() == 3);
+    REQUIRE(lazy_batch->entities[0]->is_exception());
+    REQUIRE(lazy_batch->entities[0]->to_json()["error"]["code"] == -32603);
+    REQUIRE(lazy_batch->entities[2]->is_request());
+    REQUIRE(entity->to_json() == jsonrpcpp::Parser::do_parse(scalar)->to_json());
+    const std::string single = R"({"jsonrpc": "2.0", "method": "x", "params": 5, "id": 1})";
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_lazy(single.data(), single.size()), jsonrpcpp::InternalErrorException);
+
+    // invalid JSON inside params is reported on access
+    const std::string invalid = R"({"jsonrpc": "2.0", "method": "update", "params": [1, tru]})";
+    entity = jsonrpcpp::Parser::do_parse_lazy(invalid.data(), invalid.size());
+    jsonrpcpp::notification_ptr notification = dynamic_pointer_cast<jsonrpcpp::Notification>(entity);
+    REQUIRE(notification->params().is_array());
+    REQUIRE_THROWS_AS(notification->params().get(0), jsonrpcpp::ParseErrorException);
+
+    const std::string truncated = R"({"jsonrpc": "2.0", "method": "update", "params": [1, 2})";
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_lazy(truncated.data(), truncated.size()), jsonrpcpp::ParseErrorException);
+
+    // invalid literals are reported as parse error
+    REQUIRE_THROWS_AS(jsonrpcpp::Parameter::from_raw("nul", 3), jsonrpcpp::ParseErrorException);
+    const std::string literal = R"([{"jsonrpc": "2.0", "method": "update", "params": nul}])";
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_lazy(literal.data(), literal.size()), jsonrpcpp::ParseErrorException);
+
+    // detached parameters don't depend on the parsed text
+    jsonrpcpp::Parameter detached;
+    {
+        std::string text = message;
+        entity = jsonrpcpp::Parser::do_parse_lazy(text.data(), text.size());
+        detached = dynamic_pointer_cast<jsonrpcpp::Request>(entity)->params();
+        detached.detach();
+        REQUIRE(detached.raw_data() != text.data() + text.find("{\"subtrahend"));
+    }
+    REQUIRE(detached.is_raw());
+    REQUIRE(detached.raw() == R"({"subtrahend": 23, "minuend": [42, "]"]})");
+    jsonrpcpp::Parameter moved(std::move(detached));
+    REQUIRE(moved.get<int>("subtrahend") == 23);
+
+    jsonrpcpp::Parser parser;
+    parser.set_lazy_params(true);
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Request>(parser.parse(message))->params().is_raw());
+
+    // invalid params that are decoded by a callback are reported by try_parse
+    parser.register_notification_callback("update", [](const jsonrpcpp::Parameter& params) { params.get(0); });
+    jsonrpcpp::ParseResult result = parser.try_parse(invalid);
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(result.code() == -32700);
+    REQUIRE(parser.try_parse(literal).code() == -32700);
+    REQUIRE(parser.try_parse(truncated).code() == -32700);
+    REQUIRE(parser.try_parse(R"({"jsonrpc": "2.0", "method": "update", "params": [1]})"));
+}
+
+
+TEST_CASE("Parameter storage")
+{
+    jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse(R"({"jsonrpc": "2.0", "method": "upload", "params": {"values": [1, 2, 3], "name": "x"}, "id": 1})");
+    const jsonrpcpp::Parameter& params = dynamic_pointer_cast<jsonrpcpp::Request>(entity)->params();
+    REQUIRE(params.is_map());
+    REQUIRE(&params.get("values") == &params.value()["values"]);
+    REQUIRE(params.get<std::vector<int>>("values") == std::vector<int>{1, 2, 3});
+    REQUIRE(params.get<std::string>("missing", "default") == "default");
+    REQUIRE_THROWS_AS(params.get("missing"), std::out_of_range);
+    REQUIRE_THROWS_AS(params.get(0), std::out_of_range);
+
+    jsonrpcpp::Parameter array(Json({1, 2, 3}));
+    REQUIRE(array.is_array());
+    REQUIRE(array.get<int>(2) == 3);
+    REQUIRE(!array.has(3));
+
+    jsonrpcpp::Parameter named("a", 1, "b", "two");
+    REQUIRE(named.to_json() == Json({{"a", 1}, {"b", "two"}}));
+
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse(R"({"jsonrpc": "2.0", "method": "foo", "params": "bar", "id": 1})"), jsonrpcpp::InternalErrorException);
+
+    // reparsing replaces null params
+    jsonrpcpp::Request request(Json::parse(R"({"jsonrpc": "2.0", "method": "foo", "id": 1})"));
+    REQUIRE(!request.params());
+    request.parse_json(Json::parse(R"({"jsonrpc": "2.0", "method": "foo", "params": [1], "id": 1})"));
+    REQUIRE(request.params());
+    REQUIRE(request.to_json()["params"] == Json({1}));
+}
+
+
+TEST_CASE("Flat map")
+{
+    const std::string text = R"({"m": 1, "b": [1, {"y": 2, "x": 1}], "k": "v", "a": null, "z": 1.5, "c": true, "d": 4, "e": 5, "f": 6, "g": 7, "h": {}})";
+    jsonrpcpp::flat_json flat = jsonrpcpp::flat_json::parse(text);
+    REQUIRE(flat.size() == 11);
+    REQUIRE(flat.dump() == nlohmann::json::parse(text).dump());
+    REQUIRE(flat["b"][1]["x"] == 1);
+    REQUIRE(flat.contains("k"));
+    REQUIRE(!flat.contains("l"));
+    REQUIRE(flat.erase("k") == 1);
+    REQUIRE(!flat.contains("k"));
+
+    jsonrpcpp::flat_json copy = flat;
+    REQUIRE(copy == flat);
+    copy["n"] = "new";
+    REQUIRE(copy != flat);
+    jsonrpcpp::flat_json moved = std::move(copy);
+    REQUIRE(moved["n"] == "new");
+
+    jsonrpcpp::flat_map<std::string, int> map{{"b", 2}, {"a", 1}, {"c", 3}};
+    REQUIRE(map.begin()->first == "a");
+    REQUIRE(map.at("c") == 3);
+    REQUIRE(map.emplace("a", 5).second == false);
+    REQUIRE(map.count("b") == 1);
+    REQUIRE_THROWS_AS(map.at("d"), std::out_of_range);
+}
+
+
+TEST_CASE("Id")
+{
+    jsonrpcpp::Id big(int64_t(1) << 40);
+    REQUIRE(big.type() == jsonrpcpp::Id::value_t::integer);
+    REQUIRE(big.int64_id() == (int64_t(1) << 40));
+    REQUIRE(big.to_json().dump() == "1099511627776");
+    // int_id() doesn't truncate
+    REQUIRE_THROWS_AS(big.int_id(), std::out_of_range);
+    REQUIRE_THROWS_AS(jsonrpcpp::Id(std::numeric_limits<int64_t>::max()).int_id(), std::out_of_range);
+    REQUIRE_THROWS_AS(jsonrpcpp::Id(std::numeric_limits<int64_t>::min()).int_id(), std::out_of_range);
+    REQUIRE(jsonrpcpp::Id(int64_t(std::numeric_limits<int>::min())).int_id() == std::numeric_limits<int>::min());
+    REQUIRE(jsonrpcpp::Id(-5).int_id() == -5);
+
+    jsonrpcpp::Id huge(std::numeric_limits<uint64_t>::max());
+    REQUIRE(huge.type() == jsonrpcpp::Id::value_t::unsigned_integer);
+    REQUIRE(huge.uint64_id() == std::numeric_limits<uint64_t>::max());
+    REQUIRE_THROWS_AS(huge.int_id(), std::out_of_range);
+    REQUIRE(jsonrpcpp::Id(nlohmann::json::parse("18446744073709551615")) == huge);
+    REQUIRE(jsonrpcpp::Id(nlohmann::json::parse("-5")).int64_id() == -5);
+    REQUIRE(jsonrpcpp::Id(3u).type() == jsonrpcpp::Id::value_t::integer);
+
+    jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1], "id": 9007199254740993})");
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Request>(entity)->id().int64_id() == 9007199254740993);
+
+    REQUIRE(jsonrpcpp::Id(3) == jsonrpcpp::Id(3u));
+    REQUIRE(jsonrpcpp::Id(3) != jsonrpcpp::Id("3"));
+    REQUIRE(jsonrpcpp::Id() == jsonrpcpp::Id(nullptr));
+    REQUIRE(jsonrpcpp::Id() < jsonrpcpp::Id(-1));
+    REQUIRE(jsonrpcpp::Id(-1) < jsonrpcpp::Id(1));
+    REQUIRE(jsonrpcpp::Id(1) < huge);
+    REQUIRE(huge < jsonrpcpp::Id("a"));
+    REQUIRE(!(jsonrpcpp::Id("a") < jsonrpcpp::Id("a")));
+
+    std::unordered_map<jsonrpcpp::Id, int> pending;
+    pending[jsonrpcpp::Id(1)] = 1;
+    pending[jsonrpcpp::Id("1")] = 2;
+    pending[huge] = 3;
+    REQUIRE(pending.size() == 3);
+    REQUIRE(pending.at(jsonrpcpp::Id(1u)) == 1);
+    REQUIRE(pending.at(jsonrpcpp::Id(std::string("1"))) == 2);
+    REQUIRE(pending.at(jsonrpcpp::Id(nlohmann::json::parse("18446744073709551615"))) == 3);
+}
+
+
+namespace
+{
+/// Backend building a DOM first, as a backend for another JSON library would do
+struct DomTraits
+{
+    static size_t calls;
+
+    static jsonrpcpp::entity_ptr parse(const char* json_str, size_t size)
+    {
+        ++calls;
+        return jsonrpcpp::Parser::do_parse_json(nlohmann::json::parse(json_str, json_str + size));
+    }
+};
+size_t DomTraits::calls = 0;
+
+/// Backend that fails with an exception not derived from std::exception
+struct ThrowingTraits
+{
+    static jsonrpcpp::entity_ptr parse(const char* /*json_str*/, size_t /*size*/)
+    {
+        throw 42;
+    }
+};
+} // namespace
+
+
+TEST_CASE("JSON backend")
+{
+    jsonrpcpp::BasicParser<DomTraits> parser;
+    int sum = 0;
+    parser.register_request_callback("sum", [&sum](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        sum = params.get(0).get<int>() + params.get(1).get<int>();
+        return make_shared<jsonrpcpp::Response>(id, sum);
+    });
+
+    jsonrpcpp::entity_ptr entity = parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1})");
+    REQUIRE(DomTraits::calls == 1);
+    REQUIRE(sum == 3);
+    REQUIRE(entity->is_response());
+    REQUIRE(entity->to_json() == nlohmann::json::parse(R"({"jsonrpc": "2.0", "result": 3, "id": 1})"));
+
+    REQUIRE_THROWS_AS(parser.parse(R"({"jsonrpc": "2.0", "method")"), jsonrpcpp::ParseErrorException);
+    REQUIRE(DomTraits::calls == 2);
+
+    const std::string batch = R"([{"jsonrpc": "2.0", "method": "update", "params": [1]}])";
+    entity = jsonrpcpp::Parser::do_parse_with<jsonrpcpp::nlohmann_traits>(batch.data(), batch.size());
+    REQUIRE(entity->is_batch());
+
+    // limits are enforced by a BasicParser as well
+    jsonrpcpp::ParserLimits limits;
+    limits.max_depth = 8;
+    parser.set_limits(limits);
+    const std::string nested = R"({"jsonrpc": "2.0", "method": "sum", "params": )" + std::string(100, '[') + std::string(100, ']') + "}";
+    REQUIRE_THROWS_AS(parser.parse(nested), jsonrpcpp::InvalidRequestException);
+    REQUIRE(parser.try_parse(nested).code() == -32600);
+    REQUIRE(parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [3, 4], "id": 2})")->is_response());
+    REQUIRE(sum == 7);
+
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_with<ThrowingTraits>(batch.data(), batch.size()), jsonrpcpp::ParseErrorException);
+}
+
+
+#ifdef JSONRPCPP_USE_SIMDJSON
+TEST_CASE("simdjson backend")
+{
+    std::vector<std::string> messages = {
+        R"({"jsonrpc": "2.0", "method": "subtract", "params": {"subtrahend": 23, "minuend": [42, {"a": [1.5, null, true]}]}, "foo": {"bar": [1, 2]}, "id": 3})",
+        R"({"jsonrpc": "2.0", "method": "update", "params": [1, 2, 3, 4, 5]})",
+        R"({"jsonrpc": "2.0", "result": {"a": "b"}, "id": "x"})",
+        R"({"jsonrpc": "2.0", "error": {"code": -32601, "message": "Method not found"}, "id": "1"})",
+        R"({"jsonrpc": "2.0", "method": "big", "params": [18446744073709551615, -9223372036854775808, "ä\n"], "id": 18446744073709551615})",
+        R"([{"jsonrpc": "2.0", "method": "sum", "params": [1,2,4], "id": "1"}, 1, [2], {"foo": "boo"}, {"jsonrpc": "2.0", "method": 1, "params": "bar", "id": 4}])"};
+    for (const auto& message : messages)
+    {
+        jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse_with<jsonrpcpp::simdjson_traits>(message.data(), message.size());
+        jsonrpcpp::entity_ptr expected = jsonrpcpp::Parser::do_parse_with<jsonrpcpp::nlohmann_traits>(message.data(), message.size());
+        REQUIRE(entity);
+        REQUIRE(entity->type_str() == expected->type_str());
+        REQUIRE(entity->to_json() == expected->to_json());
+    }
+
+    auto parse = [](const std::string& message) { return jsonrpcpp::Parser::do_parse_with<jsonrpcpp::simdjson_traits>(message.data(), message.size()); };
+    REQUIRE(parse(R"({"foo": "boo"})") == nullptr);
+    REQUIRE(parse(R"(42)") == nullptr);
+    REQUIRE_THROWS_AS(parse(R"({"jsonrpc": "2.0", "method": 1} x)"), jsonrpcpp::ParseErrorException);
+    REQUIRE_THROWS_AS(parse(R"({"jsonrpc": "2.0", "method")"), jsonrpcpp::ParseErrorException);
+    REQUIRE_THROWS_AS(parse(R"({"jsonrpc": "2.0", "method": "foo", "id": 1.5})"), jsonrpcpp::InvalidRequestException);
+    REQUIRE_THROWS_AS(parse(R"([])"), jsonrpcpp::InvalidRequestException);
+
+    // skipped members are validated like by the other backends
+    for (const std::string invalid : {R"({"jsonrpc": "2.0", "method": "x", "foo": tru, "id": 1})", R"({"jsonrpc": "2.0", "method": "x", "foo": [1, 2.3.4]})",
+                                      R"({"jsonrpc": "2.0", "method": "x", "foo": {"a": nul}})", R"([{"jsonrpc": "2.0", "method": "x", "foo": "\q"}])"})
+    {
+        REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_with<jsonrpcpp::nlohmann_traits>(invalid.data(), invalid.size()), jsonrpcpp::ParseErrorException);
+        REQUIRE_THROWS_AS(parse(invalid), jsonrpcpp::ParseErrorException);
+    }
+
+    // in place, if the caller provides the padding
+    std::string padded = messages[0];
+    padded.resize(messages[0].size() + simdjson::SIMDJSON_PADDING);
+    jsonrpcpp::entity_ptr in_place = jsonrpcpp::SimdjsonParser::parse(padded.data(), messages[0].size(), padded.size());
+    REQUIRE(in_place->to_json() == parse(messages[0])->to_json());
+}
+#endif
+
+
+TEST_CASE("Entity pool")
+{
+    auto pool = make_shared<jsonrpcpp::EntityPool>(2);
+    jsonrpcpp::Parser parser;
+    parser.set_entity_pool(pool);
+
+    jsonrpcpp::entity_ptr entity = parser.parse(R"({"jsonrpc": "2.0", "method": "subtract", "params": [42, 23], "id": "first"})");
+    jsonrpcpp::Entity* first = entity.get();
+    REQUIRE(pool->size() == 1);
+    entity.reset();
+
+    entity = parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": {"a": 1}, "id": 2})");
+    REQUIRE(entity.get() == first);
+    jsonrpcpp::request_ptr request = dynamic_pointer_cast<jsonrpcpp::Request>(entity);
+    REQUIRE(request->method() == "sum");
+    REQUIRE(request->id().int_id() == 2);
+    REQUIRE(request->params().get("a") == 1);
+
+    // still referenced, a second object is handed out
+    jsonrpcpp::entity_ptr second = parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1], "id": 3})");
+    REQUIRE(second.get() != first);
+    REQUIRE(pool->size() == 2);
+    // beyond max_size, the objects are not pooled
+    jsonrpcpp::entity_ptr third = parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1], "id": 4})");
+    REQUIRE(pool->size() == 2);
+
+    entity = parser.parse(R"([{"jsonrpc": "2.0", "method": "notify_hello", "params": [7]}, {"jsonrpc": "2.0", "method": "sum", "id": 5}])");
+    jsonrpcpp::Entity* batch = entity.get();
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Batch>(entity)->entities.size() == 2);
+    request.reset();
+    entity.reset();
+    entity = parser.parse(R"([{"jsonrpc": "2.0", "method": "notify_hello", "params": [8]}])");
+    REQUIRE(entity.get() == batch);
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Batch>(entity)->entities.size() == 1);
+
+    jsonrpcpp::response_ptr response = pool->make<jsonrpcpp::Response>(jsonrpcpp::Id(6), 19);
+    REQUIRE(response->to_json() == nlohmann::json::parse(R"({"jsonrpc": "2.0", "result": 19, "id": 6})"));
+    jsonrpcpp::Entity* pooled = response.get();
+    response.reset();
+    REQUIRE(pool->make<jsonrpcpp::Response>(jsonrpcpp::Id(7), 20).get() == pooled);
+
+    // recycled objects keep the capacity of their strings
+    const std::string long_name(200, 'm');
+    jsonrpcpp::request_ptr made = pool->make<jsonrpcpp::Request>(jsonrpcpp::Id(long_name), long_name, nlohmann::json({1}));
+    jsonrpcpp::Entity* recycled = made.get();
+    made.reset();
+    made = pool->make<jsonrpcpp::Request>(jsonrpcpp::Id("a"), "b");
+    REQUIRE(made.get() == recycled);
+    REQUIRE(made->method() == "b");
+    REQUIRE(made->method().capacity() >= long_name.size());
+    REQUIRE(made->id().string_id().capacity() >= long_name.size());
+    REQUIRE(!made->params());
+    jsonrpcpp::notification_ptr note = pool->make<jsonrpcpp::Notification>(long_name);
+    recycled = note.get();
+    note.reset();
+    note = pool->make<jsonrpcpp::Notification>("n", nlohmann::json({2}));
+    REQUIRE(note.get() == recycled);
+    REQUIRE(note->method().capacity() >= long_name.size());
+    REQUIRE(note->params().get<int>(0) == 2);
+
+    parser.set_entity_pool(nullptr);
+    entity = parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1], "id": 8})");
+    REQUIRE(entity.get() != first);
+}
+
+TEST_CASE("Any entity")
+{
+    jsonrpcpp::AnyEntity entity = jsonrpcpp::Parser::do_parse_any(R"({"jsonrpc": "2.0", "method": "subtract", "params": [42, 23], "id": 1})");
+    REQUIRE(entity.is_request());
+    REQUIRE(entity.type() == jsonrpcpp::Entity::entity_t::request);
+    REQUIRE(entity.as_request().method() == "subtract");
+    REQUIRE(entity.as_request().params().get(1) == 23);
+    REQUIRE(entity.get()->is_request());
+    REQUIRE(entity.to_ptr()->to_json() == entity.to_json());
+
+    jsonrpcpp::AnyEntity copy = entity;
+    jsonrpcpp::AnyEntity moved = std::move(entity);
+    REQUIRE(copy.to_json() == moved.to_json());
+    copy = jsonrpcpp::AnyEntity(jsonrpcpp::Error("Invalid Request", -32600));
+    REQUIRE(copy.is_error());
+    REQUIRE(copy.as_error().code() == -32600);
+
+    std::string method;
+    size_t visited = moved.visit([&method](const jsonrpcpp::Entity& visited_entity) -> size_t {
+        method = visited_entity.type_str();
+        return 1;
+    });
+    REQUIRE(visited == 1);
+    REQUIRE(method == "request");
+
+    entity = jsonrpcpp::Parser::do_parse_any(R"({"jsonrpc": "2.0", "method": "update", "params": {"a": 1}})");
+    REQUIRE(entity.as_notification().params().get("a") == 1);
+    entity = jsonrpcpp::Parser::do_parse_any(R"({"jsonrpc": "2.0", "result": 19, "id": 3})");
+    REQUIRE(entity.as_response().result() == 19);
+    entity = jsonrpcpp::Parser::do_parse_any(R"([{"jsonrpc": "2.0", "method": "update"}, {"foo": "boo"}])");
+    REQUIRE(entity.as_batch().entities.size() == 2);
+    entity = jsonrpcpp::Parser::do_parse_any("5");
+    REQUIRE(entity.empty());
+    REQUIRE(!entity);
+    REQUIRE(entity.get() == nullptr);
+    REQUIRE(entity.visit([](const jsonrpcpp::Entity&) { return 1; }) == 0);
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_any(R"({"jsonrpc": "2.0", "method")"), jsonrpcpp::ParseErrorException);
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_any(R"({"jsonrpc": "2.0", "method": 1, "id": 1})"), jsonrpcpp::InvalidRequestException);
+
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("sum", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        return make_shared<jsonrpcpp::Response>(id, params.get(0).get<int>() + params.get(1).get<int>());
+    });
+    entity = parser.parse_any(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1})");
+    REQUIRE(entity.is_response());
+    REQUIRE(entity.as_response().result() == 3);
+}
+
+TEST_CASE("Non-throwing parse")
+{
+    jsonrpcpp::ParseResult result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "2.0", "method": "subtract", "params": [42, 23], "id": 1})");
+    REQUIRE(result);
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::none);
+    REQUIRE(result.entity()->is_request());
+
+    result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "2.0", "method": "foobar, "params": "bar", "baz])");
+    REQUIRE(!result);
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(result.code() == -32700);
+    REQUIRE(result.entity() == nullptr);
+    REQUIRE_THROWS_AS(result.value_or_throw(), jsonrpcpp::ParseErrorException);
+
+    result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "2.0", "method": 1, "params": "bar", "id": "x"})");
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::request_error);
+    REQUIRE(result.code() == -32600);
+    REQUIRE(result.id().string_id() == "x");
+    REQUIRE(result.error().data() == "method must be a string value");
+    REQUIRE_THROWS_AS(result.value_or_throw(), jsonrpcpp::InvalidRequestException);
+
+    result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "2.0", "method": "foo", "params": "bar", "id": 1})");
+    REQUIRE(result.code() == -32603);
+    REQUIRE(result.id().int_id() == 1);
+    REQUIRE_THROWS_AS(result.value_or_throw(), jsonrpcpp::InternalErrorException);
+
+    result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "2.0", "method": "foo", "id": 1.5})");
+    REQUIRE(result.code() == -32600);
+    REQUIRE(result.id().type() == jsonrpcpp::Id::value_t::null);
+
+    result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "1.0", "method": "update"})");
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::rpc_error);
+    REQUIRE(result.error().message() == "invalid jsonrpc value: 1.0");
+    REQUIRE_THROWS_AS(result.value_or_throw(), jsonrpcpp::RpcException);
+
+    result = jsonrpcpp::Parser::do_try_parse(R"({"jsonrpc": "2.0", "error": {"code": "x", "message": "m"}, "id": 1})");
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::rpc_error);
+
+    result = jsonrpcpp::Parser::do_try_parse("[]");
+    REQUIRE(result.code() == -32600);
+
+    result = jsonrpcpp::Parser::do_try_parse("5");
+    REQUIRE(result);
+    REQUIRE(result.entity() == nullptr);
+
+    result = jsonrpcpp::Parser::do_try_parse(R"([{"jsonrpc": "2.0", "method": "sum", "id": 1}, {"jsonrpc": "2.0", "method": 1, "id": 2}, {"foo": "boo"}])");
+    REQUIRE(result);
+    jsonrpcpp::batch_ptr batch = dynamic_pointer_cast<jsonrpcpp::Batch>(result.entity());
+    REQUIRE(batch->entities.size() == 3);
+    REQUIRE(batch->entities[0]->is_request());
+    REQUIRE(batch->entities[1]->is_exception());
+    REQUIRE(batch->entities[1]->to_json()["id"] == 2);
+    REQUIRE(batch->entities[2]->is_error());
+
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("sum", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        return make_shared<jsonrpcpp::Response>(id, params.get(0).get<int>() + params.get(1).get<int>());
+    });
+    result = parser.try_parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1})");
+    REQUIRE(result.entity()->is_response());
+    result = parser.try_parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2]})");
+    REQUIRE(result.entity()->is_notification());
+}
+
+TEST_CASE("Stream decoder")
+{
+    std::vector<jsonrpcpp::ParseResult> results;
+    jsonrpcpp::StreamDecoder decoder([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); });
+
+    const std::string stream = R"({"jsonrpc": "2.0", "method": "sum", "params": ["}", "\"{"], "id": 1} )"
+                               R"([{"jsonrpc": "2.0", "method": "update", "params": [[1], {"a": 2}]}])"
+                               "\n"
+                               R"({"jsonrpc": "2.0", "result": 19, "id": 2})";
+    // byte by byte
+    for (char c : stream)
+        decoder.feed(&c, 1);
+    REQUIRE(decoder.pending() == 0);
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[0].entity()->is_request());
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Request>(results[0].entity())->params().get(1) == "\"{");
+    REQUIRE(results[1].entity()->is_batch());
+    REQUIRE(results[2].entity()->is_response());
+
+    // all at once, and split in the middle of a message
+    results.clear();
+    decoder.feed(stream);
+    REQUIRE(results.size() == 3);
+    decoder.feed(stream.substr(0, 20));
+    REQUIRE(results.size() == 3);
+    REQUIRE(decoder.pending() == 20);
+    decoder.feed(stream.substr(20));
+    REQUIRE(results.size() == 6);
+    REQUIRE(results[5].entity()->is_response());
+
+    // garbage between messages and invalid messages
+    results.clear();
+    decoder.feed(R"(x{"jsonrpc": "2.0", "method": 1, "id": 3}{"jsonrpc")");
+    REQUIRE(results.size() == 2);
+    REQUIRE(results[0].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(results[1].code() == -32600);
+    REQUIRE(decoder.pending() > 0);
+    decoder.reset();
+    REQUIRE(decoder.pending() == 0);
+    decoder.feed(R"({"jsonrpc": "2.0" "method"})");
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[2].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("sum", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        return make_shared<jsonrpcpp::Response>(id, params.get(0).get<int>() + params.get(1).get<int>());
+    });
+    jsonrpcpp::StreamDecoder dispatching(parser, [&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); });
+    dispatching.feed(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1})");
+    REQUIRE(results.back().entity()->is_response());
+
+    // messages above max_size are skipped, also when they are never terminated
+    results.clear();
+    jsonrpcpp::StreamDecoder limited([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); }, 64);
+    const std::string small = R"({"jsonrpc": "2.0", "result": 1, "id": 1})";
+    const std::string large = R"({"jsonrpc": "2.0", "result": ")" + std::string(100, 'x') + R"(", "id": 2})";
+    limited.feed(large + small);
+    REQUIRE(results.size() == 2);
+    REQUIRE(results[0].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(results[1].entity()->is_response());
+    for (char c : large + small)
+        limited.feed(&c, 1);
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[2].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(results[3].entity()->is_response());
+    limited.feed("[" + std::string(100, '['));
+    for (size_t n = 0; n < 1000; ++n)
+        limited.feed("[[[[");
+    REQUIRE(results.size() == 5);
+    REQUIRE(limited.pending() <= 64);
+}
+
+TEST_CASE("NDJSON")
+{
+    std::string text(100, 'x');
+    for (size_t pos = 0; pos < text.size(); ++pos)
+    {
+        text[pos] = '\n';
+        for (size_t first = 0; first <= pos; first += 7)
+            REQUIRE(jsonrpcpp::find_newline(text.data() + first, text.data() + text.size()) == text.data() + pos);
+        REQUIRE(jsonrpcpp::find_newline(text.data(), text.data() + pos) == text.data() + pos);
+        text[pos] = 'x';
+    }
+
+    std::vector<jsonrpcpp::ParseResult> results;
+    jsonrpcpp::NdjsonCodec codec([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); });
+    const std::string stream = "{\"jsonrpc\": \"2.0\", \"method\": \"sum\", \"params\": [1, 2], \"id\": 1}\r\n"
+                               "\n"
+                               "[{\"jsonrpc\": \"2.0\", \"method\": \"update\"}]\n"
+                               "{\"jsonrpc\": \"2.0\", \"method\"\n"
+                               "{\"jsonrpc\": \"2.0\", \"result\": 19, \"id\": 2}";
+    for (size_t chunk : {size_t(1), size_t(5), stream.size()})
+    {
+        results.clear();
+        for (size_t pos = 0; pos < stream.size(); pos += chunk)
+            codec.feed(stream.data() + pos, std::min(chunk, stream.size() - pos));
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[0].entity()->is_request());
+        REQUIRE(results[1].entity()->is_batch());
+        REQUIRE(results[2].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+        REQUIRE(codec.pending() > 0);
+        codec.finish();
+        REQUIRE(codec.pending() == 0);
+        REQUIRE(results.size() == 4);
+        REQUIRE(results[3].entity()->is_response());
+    }
+
+    std::string out;
+    jsonrpcpp::NdjsonCodec::encode(jsonrpcpp::Response(jsonrpcpp::Id(1), 3), out);
+    jsonrpcpp::NdjsonCodec::encode(jsonrpcpp::Notification("update", nlohmann::json({1})), out);
+    REQUIRE(out == jsonrpcpp::Response(jsonrpcpp::Id(1), 3).to_json().dump() + "\n" + jsonrpcpp::Notification("update", nlohmann::json({1})).to_json().dump() + "\n");
+
+    // lines above max_size are skipped up to the next newline, also when they arrive in chunks
+    results.clear();
+    jsonrpcpp::NdjsonCodec limited([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); }, 64);
+    const std::string small = R"({"jsonrpc": "2.0", "result": 1, "id": 1})";
+    for (size_t n = 0; n < 1000; ++n)
+        limited.feed(std::string(100, 'x'));
+    REQUIRE(results.size() == 1);
+    REQUIRE(results[0].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(limited.pending() == 0);
+    limited.feed("xxx\n" + small + "\n" + std::string(100, 'x') + "\n" + small + "\n");
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[1].entity()->is_response());
+    REQUIRE(results[2].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(results[3].entity()->is_response());
+    REQUIRE(limited.pending() == 0);
+}
+
+TEST_CASE("Content-Length framing")
+{
+    std::vector<jsonrpcpp::ParseResult> results;
+    jsonrpcpp::ContentLengthCodec codec([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); });
+
+    std::string stream;
+    codec.encode(jsonrpcpp::Request(jsonrpcpp::Id(1), "sum", nlohmann::json({1, 2})), stream);
+    const std::string request = jsonrpcpp::Request(jsonrpcpp::Id(1), "sum", nlohmann::json({1, 2})).to_json().dump();
+    REQUIRE(stream == "Content-Length: " + std::to_string(request.size()) + "\r\n\r\n" + request);
+    // shorter and longer than the previous message
+    codec.encode(jsonrpcpp::Response(jsonrpcpp::Id(1), 3), stream);
+    codec.encode(jsonrpcpp::Notification("update", nlohmann::json({std::string(2000, 'x')})), stream);
+    stream += "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\ncontent-length:  2 \r\n\r\n{}";
+    stream += "Content-Type: text\r\n\r\n";
+    codec.encode(jsonrpcpp::Response(jsonrpcpp::Id(2), 4), stream);
+
+    for (size_t chunk : {size_t(1), size_t(7), stream.size()})
+    {
+        results.clear();
+        for (size_t pos = 0; pos < stream.size(); pos += chunk)
+            codec.feed(stream.data() + pos, std::min(chunk, stream.size() - pos));
+        REQUIRE(codec.pending() == 0);
+        REQUIRE(results.size() == 6);
+        REQUIRE(results[0].entity()->is_request());
+        REQUIRE(results[1].entity()->is_response());
+        REQUIRE(dynamic_pointer_cast<jsonrpcpp::Notification>(results[2].entity())->params().get(0).get<std::string>().size() == 2000);
+        REQUIRE(results[3]);
+        REQUIRE(results[3].entity() == nullptr);
+        REQUIRE(results[4].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+        REQUIRE(dynamic_pointer_cast<jsonrpcpp::Response>(results[5].entity())->result() == 4);
+    }
+
+    // reading directly into the codec's buffer
+    results.clear();
+    size_t pos = 0;
+    while (pos < stream.size())
+    {
+        size_t size = std::min(size_t(100), stream.size() - pos);
+        char* buffer = codec.prepare(200);
+        memcpy(buffer, stream.data() + pos, size);
+        codec.commit(size);
+        pos += size;
+    }
+    REQUIRE(results.size() == 6);
+    REQUIRE(codec.pending() == 0);
+
+    codec.feed("Content-Length: 10\r\n\r\n{");
+    REQUIRE(codec.pending() > 0);
+    codec.reset();
+    REQUIRE(codec.pending() == 0);
+
+    // oversized messages are skipped without being buffered, oversized headers are discarded
+    results.clear();
+    jsonrpcpp::ContentLengthCodec limited([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); }, 1024);
+    limited.feed("Content-Length: 99999999999999\r\n\r\n{\"jsonrpc\"");
+    REQUIRE(results.size() == 1);
+    REQUIRE(results[0].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(limited.pending() == 0);
+    limited.reset();
+    std::string large;
+    limited.encode(jsonrpcpp::Notification("update", nlohmann::json({std::string(2000, 'x')})), large);
+    limited.encode(jsonrpcpp::Response(jsonrpcpp::Id(2), 4), large);
+    for (size_t offset = 0; offset < large.size(); offset += 100)
+        limited.feed(large.data() + offset, std::min(size_t(100), large.size() - offset));
+    REQUIRE(results.size() == 3);
+    REQUIRE(results[1].kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(results[2].entity()->is_response());
+    REQUIRE(limited.pending() == 0);
+    limited.feed("Content-Type: " + std::string(2000, 'x'));
+    REQUIRE(results.size() == 4);
+    REQUIRE(limited.pending() == 0);
+}
+
+TEST_CASE("Streaming batch")
+{
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("sum", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        return make_shared<jsonrpcpp::Response>(id, params.get(0).get<int>() + params.get(1).get<int>());
+    });
+
+    std::vector<jsonrpcpp::entity_ptr> elements;
+    bool batch_elements = true;
+    auto collect = [&elements, &batch_elements](const jsonrpcpp::entity_ptr& element, bool batch_element) {
+        elements.push_back(element);
+        batch_elements = batch_elements && batch_element;
+    };
+    const std::string batch = R"([
+        {"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1},
+        {"jsonrpc": "2.0", "method": "update", "params": [1]},
+        {"jsonrpc": "2.0", "method": 1, "id": 2},
+        1
+    ])";
+    jsonrpcpp::ParseResult result = parser.parse_streaming(batch, collect);
+    REQUIRE(result);
+    REQUIRE(result.entity() == nullptr);
+    REQUIRE(elements.size() == 4);
+    REQUIRE(batch_elements);
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Response>(elements[0])->result() == 3);
+    REQUIRE(elements[1]->is_notification());
+    REQUIRE(elements[2]->is_exception());
+    REQUIRE(elements[2]->to_json()["id"] == 2);
+    REQUIRE(elements[3]->is_error());
+
+    // a single message is passed to the callback as well
+    elements.clear();
+    result = parser.parse_streaming(R"({"jsonrpc": "2.0", "method": "sum", "params": [3, 4], "id": 3})", collect);
+    REQUIRE(result);
+    REQUIRE(elements.size() == 1);
+    REQUIRE(!batch_elements);
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Response>(elements[0])->result() == 7);
+
+    // elements before a parse error are delivered
+    elements.clear();
+    result = parser.parse_streaming(R"([{"jsonrpc": "2.0", "method": "update"}, {"jsonrpc": )", collect);
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::parse_error);
+    REQUIRE(elements.size() == 1);
+
+    elements.clear();
+    result = parser.parse_streaming("[]", collect);
+    REQUIRE(result.kind() == jsonrpcpp::ParseResult::error_t::request_error);
+    REQUIRE(elements.empty());
+}
+
+#ifdef JSONRPCPP_USE_THREADS
+TEST_CASE("Parallel batch")
+{
+    std::string json_str = "[";
+    for (int n = 0; n < 500; ++n)
+    {
+        if (n != 0)
+            json_str += ", ";
+        if (n % 50 == 7)
+            json_str += R"({"jsonrpc": "2.0", "method": 1, "id": )" + std::to_string(n) + "}";
+        else if (n % 50 == 9)
+            json_str += "[1]";
+        else
+            json_str += R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": )" + std::to_string(n) + "}";
+    }
+    json_str += "]";
+
+    const nlohmann::json expected = jsonrpcpp::Parser::do_parse(json_str)->to_json();
+    for (size_t threads : {size_t(0), size_t(1), size_t(3), size_t(100)})
+    {
+        jsonrpcpp::ThreadPool pool(threads);
+        REQUIRE(pool.size() >= std::max(threads, size_t(1)));
+        // the workers are reused by subsequent calls
+        for (size_t n = 0; n < 3; ++n)
+        {
+            jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse_parallel(json_str, pool);
+            REQUIRE(entity->is_batch());
+            jsonrpcpp::batch_ptr batch = dynamic_pointer_cast<jsonrpcpp::Batch>(entity);
+            REQUIRE(batch->entities.size() == 500);
+            REQUIRE(batch->entities[7]->is_exception());
+            REQUIRE(batch->to_json() == expected);
+        }
+    }
+
+    jsonrpcpp::ThreadPool pool(4);
+    REQUIRE(jsonrpcpp::Parser::do_parse_parallel(R"({"jsonrpc": "2.0", "method": "update"})", pool)->is_notification());
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_parallel("[]", pool), jsonrpcpp::InvalidRequestException);
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_parallel(json_str.substr(0, json_str.size() - 1), pool), jsonrpcpp::ParseErrorException);
+    // invalid JSON in an element of a worker thread fails the whole batch
+    json_str.replace(json_str.rfind("[1, 2]"), 6, "[1, x]");
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_parallel(json_str, pool), jsonrpcpp::ParseErrorException);
+}
+#endif
+
+TEST_CASE("Binary formats")
+{
+    jsonrpcpp::Batch batch;
+    batch.add(jsonrpcpp::Request(jsonrpcpp::Id(1), "sum", nlohmann::json({1, 2.5, "x"})));
+    batch.add(jsonrpcpp::Notification("update", nlohmann::json({{"key", nullptr}})));
+    batch.add(jsonrpcpp::Response(jsonrpcpp::Id("a"), nlohmann::json({true, false})));
+    batch.add(jsonrpcpp::Response(jsonrpcpp::InvalidParamsException("bad", jsonrpcpp::Id(2))));
+
+    using format_t = jsonrpcpp::binary_format_t;
+    for (format_t format : {format_t::cbor, format_t::msgpack, format_t::ubjson, format_t::bjdata})
+    {
+        std::vector<uint8_t> buffer;
+        batch.serialize(format, buffer);
+        jsonrpcpp::entity_ptr entity = jsonrpcpp::Parser::do_parse_binary(buffer, format);
+        REQUIRE(entity->is_batch());
+        REQUIRE(entity->to_json() == batch.to_json());
+
+        // serialize appends
+        size_t size = buffer.size();
+        batch.entities[0]->serialize(format, buffer);
+        entity = jsonrpcpp::Parser::do_parse_binary(buffer.data() + size, buffer.size() - size, format);
+        REQUIRE(entity->is_request());
+        REQUIRE(entity->to_json() == batch.entities[0]->to_json());
+
+        REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_binary(buffer.data(), size - 1, format), jsonrpcpp::ParseErrorException);
+    }
+
+    std::vector<uint8_t> buffer = nlohmann::json::to_msgpack(nlohmann::json::parse(R"({"jsonrpc": "2.0", "method": 1, "id": 1})"));
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse_binary(buffer, format_t::msgpack), jsonrpcpp::InvalidRequestException);
+
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("sum", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        return make_shared<jsonrpcpp::Response>(id, params.get(0).get<int>() + params.get(1).get<int>());
+    });
+    buffer.clear();
+    jsonrpcpp::Request(jsonrpcpp::Id(1), "sum", nlohmann::json({1, 2})).serialize(format_t::cbor, buffer);
+    jsonrpcpp::response_ptr response = dynamic_pointer_cast<jsonrpcpp::Response>(parser.parse_binary(buffer, format_t::cbor));
+    REQUIRE(response->result() == 3);
+}
+
+TEST_CASE("Parameter schema")
+{
+    using type_t = jsonrpcpp::ParamSchema::type_t;
+    jsonrpcpp::ParamSchema schema;
+    schema.required("a", type_t::integer).required("b", type_t::number).optional("name", type_t::string);
+    REQUIRE(schema.check(nlohmann::json({1, 2.5})).empty());
+    REQUIRE(schema.check(nlohmann::json({1, 2, "x", true})).empty());
+    REQUIRE(schema.check(nlohmann::json({{"b", 2}, {"a", 1}, {"other", 1}})).empty());
+    REQUIRE(schema.check(nlohmann::json({1.5, 2})) == "parameter 'a' must be integer");
+    REQUIRE(schema.check(nlohmann::json({1})) == "missing parameter 'b'");
+    REQUIRE(schema.check(nlohmann::json({{"a", 1}, {"b", 2}, {"name", 3}})) == "parameter 'name' must be string");
+    REQUIRE(schema.check(nlohmann::json(nullptr)) == "missing parameter 'a'");
+    schema.strict();
+    REQUIRE(schema.check(nlohmann::json({1, 2, "x", true})) == "too many parameters");
+    REQUIRE(schema.check(nlohmann::json({{"b", 2}, {"a", 1}, {"other", 1}})) == "unknown parameter 'other'");
+    REQUIRE(jsonrpcpp::ParamSchema().check(jsonrpcpp::Parameter(nullptr)).empty());
+
+    jsonrpcpp::Parser parser;
+    size_t calls = 0;
+    parser.register_request_callback(
+        "sum",
+        [&calls](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+            ++calls;
+            return make_shared<jsonrpcpp::Response>(id, params.get<int>(0) + params.get<int>(1));
+        },
+        jsonrpcpp::ParamSchema().required("a", type_t::integer).required("b", type_t::integer));
+
+    jsonrpcpp::response_ptr response =
+        dynamic_pointer_cast<jsonrpcpp::Response>(parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1})"));
+    REQUIRE(response->result() == 3);
+    REQUIRE(calls == 1);
+
+    try
+    {
+        parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, "2"], "id": 2})");
+        FAIL("InvalidParamsException expected");
+    }
+    catch (const jsonrpcpp::InvalidParamsException& e)
+    {
+        REQUIRE(e.to_json()["error"]["code"] == -32602);
+        REQUIRE(e.to_json()["error"]["data"] == "parameter 'b' must be integer");
+        REQUIRE(e.to_json()["id"] == 2);
+    }
+    REQUIRE(calls == 1);
+
+    jsonrpcpp::ParseResult result = parser.try_parse(R"({"jsonrpc": "2.0", "method": "sum", "params": {"a": 1}, "id": 3})");
+    REQUIRE(result.code() == -32602);
+    REQUIRE(calls == 1);
+
+    // registering without a schema drops it
+    parser.register_request_callback("sum", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter&) { return make_shared<jsonrpcpp::Response>(id, 0); });
+    REQUIRE(parser.parse(R"({"jsonrpc": "2.0", "method": "sum", "params": [1, "2"], "id": 4})")->is_response());
+}
+
+TEST_CASE("Parser limits")
+{
+    const std::string request = R"({"jsonrpc": "2.0", "method": "sum", "params": [1, [2, [3]]], "id": 1})";
+    REQUIRE(jsonrpcpp::Parser::do_try_parse(request.data(), request.size(), jsonrpcpp::ParserLimits()));
+
+    auto failure = [&request](const jsonrpcpp::ParserLimits& limits) {
+        jsonrpcpp::ParseResult result = jsonrpcpp::Parser::do_try_parse(request.data(), request.size(), limits);
+        REQUIRE(result.code() == -32600);
+        return result.error().data().get<std::string>();
+    };
+
+    jsonrpcpp::ParserLimits limits;
+    limits.max_size = request.size() - 1;
+    REQUIRE(failure(limits) == "limit exceeded: max_size");
+    limits = jsonrpcpp::ParserLimits();
+    limits.max_depth = 3;
+    REQUIRE(failure(limits) == "limit exceeded: max_depth");
+    limits.max_depth = 4;
+    REQUIRE(jsonrpcpp::Parser::do_try_parse(request.data(), request.size(), limits));
+    limits = jsonrpcpp::ParserLimits();
+    limits.max_string_length = 2;
+    REQUIRE(failure(limits) == "limit exceeded: max_string_length");
+    limits = jsonrpcpp::ParserLimits();
+    limits.max_array_size = 3;
+    REQUIRE(failure(limits) == "limit exceeded: max_array_size");
+
+    const std::string batch = "[" + request + ", " + request + ", " + request + "]";
+    limits = jsonrpcpp::ParserLimits();
+    limits.max_batch_size = 3;
+    REQUIRE(jsonrpcpp::Parser::do_parse(batch.data(), batch.size(), limits)->is_batch());
+    limits.max_batch_size = 2;
+    REQUIRE_THROWS_AS(jsonrpcpp::Parser::do_parse(batch.data(), batch.size(), limits), jsonrpcpp::InvalidRequestException);
+
+    // deeply nested values are rejected before they are materialized
+    const std::string nested = R"({"jsonrpc": "2.0", "method": "sum", "params": )" + std::string(10000, '[') + std::string(10000, ']') + "}";
+    limits = jsonrpcpp::ParserLimits();
+    limits.max_depth = 32;
+    jsonrpcpp::Parser parser;
+    parser.set_limits(limits);
+    REQUIRE_THROWS_AS(parser.parse(nested), jsonrpcpp::InvalidRequestException);
+    REQUIRE(parser.try_parse(nested).code() == -32600);
+    REQUIRE_THROWS_AS(parser.parse_any(nested), jsonrpcpp::InvalidRequestException);
+    REQUIRE(parser.parse(request)->is_request());
+}
+
+TEST_CASE("Direct serialization")
+{
+    jsonrpcpp::Batch batch;
+    batch.add(jsonrpcpp::Request(jsonrpcpp::Id(1), "sum", nlohmann::json({1, 2.5, "x"})));
+    batch.add(jsonrpcpp::Request(jsonrpcpp::Id("a\"b"), "no_params"));
+    batch.add(jsonrpcpp::Request(jsonrpcpp::Id(std::numeric_limits<uint64_t>::max()), "mäthod", nlohmann::json({{"key", "value"}})));
+    batch.add(jsonrpcpp::Notification("update", nlohmann::json({{"b", nullptr}, {"a", {1, 2}}})));
+    batch.add(jsonrpcpp::Notification("tab\tnewline\n"));
+    batch.add(jsonrpcpp::Response(jsonrpcpp::Id(-5), nlohmann::json({{"z", 1}, {"y", "\u0001"}})));
+    batch.add(jsonrpcpp::Response(jsonrpcpp::Id(), nlohmann::json(nullptr)));
+    batch.add(jsonrpcpp::Response(jsonrpcpp::Id(2), jsonrpcpp::Error("failed", -32000, nlohmann::json({{"reason", "x"}}))));
+    batch.add(jsonrpcpp::InvalidParamsException("bad", jsonrpcpp::Id(3)));
+    batch.add(jsonrpcpp::ParseErrorException("unexpected end"));
+    batch.add(jsonrpcpp::Error("Invalid request", -32600));
+
+    for (const auto& entity : batch.entities)
+    {
+        std::string out = "prefix";
+        entity->append_to(out);
+        REQUIRE(out == "prefix" + entity->to_json().dump());
+    }
+    std::string out;
+    batch.append_to(out);
+    REQUIRE(out == batch.to_json().dump());
+
+    out.clear();
+    jsonrpcpp::Batch().append_to(out);
+    REQUIRE(out == jsonrpcpp::Batch().to_json().dump());
+
+    struct CountingBuffer : public jsonrpcpp::OutputBuffer
+    {
+        void write(const char* data, size_t size) override
+        {
+            text.append(data, size);
+            ++writes;
+        }
+
+        std::string text;
+        size_t writes = 0;
+    };
+    CountingBuffer buffer;
+    batch.write_to(buffer);
+    REQUIRE(buffer.text == batch.to_json().dump());
+    REQUIRE(buffer.writes > batch.entities.size());
+}
+
+TEST_CASE("Raw JSON result")
+{
+    auto cached = std::make_shared<const std::string>(R"({"b": [1, 2],  "a": "x"})");
+    jsonrpcpp::Response response(jsonrpcpp::Id(1), jsonrpcpp::RawJson(cached));
+    REQUIRE(response.raw_result() == cached.get());
+
+    std::string out;
+    response.append_to(out);
+    REQUIRE(out == R"({"id":1,"jsonrpc":"2.0","result":{"b": [1, 2],  "a": "x"}})");
+    REQUIRE(response.result()["b"][1] == 2);
+    REQUIRE(response.to_json() == nlohmann::json::parse(out));
+
+    // the text is validated, unless it is explicitly trusted
+    REQUIRE(jsonrpcpp::RawJson("[1, 2]").is_valid());
+    REQUIRE_THROWS_AS(jsonrpcpp::RawJson("[1, 2"), jsonrpcpp::ParseErrorException);
+    REQUIRE_THROWS_AS(jsonrpcpp::RawJson(std::make_shared<const std::string>("{\"a\": }")), jsonrpcpp::ParseErrorException);
+    REQUIRE_FALSE(jsonrpcpp::RawJson::trusted("[1, 2").is_valid());
+    REQUIRE(jsonrpcpp::RawJson::trusted(cached).ptr() == cached);
+    REQUIRE_THROWS_AS(jsonrpcpp::Response(jsonrpcpp::Id(2), jsonrpcpp::RawJson::trusted("{")).result(), jsonrpcpp::ParseErrorException);
+
+    // NDJSON keeps a pretty-printed result on one line
+    const std::string pretty = "{\n  \"b\": [\n    1,\n    2\n  ],\r\n  \"a\": \"x\\ny\"\n}";
+    out.clear();
+    jsonrpcpp::NdjsonCodec::encode(jsonrpcpp::Response(jsonrpcpp::Id(1), jsonrpcpp::RawJson(pretty)), out);
+    REQUIRE(out.find('\n') == out.size() - 1);
+    REQUIRE(nlohmann::json::parse(out)["result"] == nlohmann::json::parse(pretty));
+    std::vector<jsonrpcpp::ParseResult> results;
+    jsonrpcpp::NdjsonCodec codec([&results](const jsonrpcpp::ParseResult& result) { results.push_back(result); });
+    codec.feed(out);
+    REQUIRE(results.size() == 1);
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Response>(results[0].entity())->result()["a"] == "x\ny");
+
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("get", [&cached](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter&) {
+        return make_shared<jsonrpcpp::Response>(id, jsonrpcpp::RawJson(cached));
+    });
+    jsonrpcpp::entity_ptr entity = parser.parse(R"({"jsonrpc": "2.0", "method": "get", "id": "q"})");
+    out.clear();
+    entity->append_to(out);
+    REQUIRE(out == R"({"id":"q","jsonrpc":"2.0","result":{"b": [1, 2],  "a": "x"}})");
+
+    // parsed responses have no raw result
+    entity = jsonrpcpp::Parser::do_parse(out);
+    REQUIRE(dynamic_pointer_cast<jsonrpcpp::Response>(entity)->raw_result() == nullptr);
+}
+
+TEST_CASE("Scatter-gather output")
+{
+    auto payload = std::make_shared<const std::string>("\"" + std::string(1000, '1') + "\"");
+    jsonrpcpp::Batch batch;
+    batch.add(jsonrpcpp::Response(jsonrpcpp::Id(1), jsonrpcpp::RawJson(payload)));
+    batch.add(jsonrpcpp::Response(jsonrpcpp::Id(2), nlohmann::json({{"key", std::string(5000, 'x')}})));
+    batch.add(jsonrpcpp::Notification("update", nlohmann::json({1, 2})));
+    std::string expected;
+    batch.append_to(expected);
+
+    jsonrpcpp::IovecBuffer buffer;
+    batch.write_to(buffer);
+    REQUIRE(buffer.size() == expected.size());
+    REQUIRE(buffer.str() == expected);
+    // the payload is referenced, the small fragments around it are merged,
+    // the long string of the second response starts a new chunk
+    REQUIRE(buffer.segments().size() == 4);
+    REQUIRE(buffer.segments()[1].data == payload->data());
+
+    // everything referenced
+    jsonrpcpp::IovecBuffer references(0);
+    batch.write_to(references);
+    REQUIRE(references.str() == expected);
+    REQUIRE(references.segments().size() > buffer.segments().size());
+
+    buffer.clear();
+    REQUIRE(buffer.size() == 0);
+    REQUIRE(buffer.segments().empty());
+    jsonrpcpp::Response(jsonrpcpp::Id(3), 3).write_to(buffer);
+    REQUIRE(buffer.str() == R"({"id":3,"jsonrpc":"2.0","result":3})");
+
+#ifdef JSONRPCPP_HAS_IOVEC
+    std::vector<struct iovec> iov;
+    references.to_iovec(iov);
+    REQUIRE(iov.size() == references.segments().size());
+    std::string gathered;
+    for (const auto& vec : iov)
+        gathered.append(static_cast<const char*>(vec.iov_base), vec.iov_len);
+    REQUIRE(gathered == expected);
+#endif
+}
+
+TEST_CASE("Batch writer")
+{
+    std::string out;
+    size_t chunks = 0;
+    jsonrpcpp::BatchWriter writer(
+        [&out, &chunks](const char* data, size_t size) {
+            out.append(data, size);
+            ++chunks;
+        },
+        64);
+
+    jsonrpcpp::Batch batch;
+    for (int n = 0; n < 20; ++n)
+        batch.add(jsonrpcpp::Response(jsonrpcpp::Id(n), n * n));
+    for (const auto& entity : batch.entities)
+    {
+        writer.add(entity);
+        writer.add(jsonrpcpp::Notification("update"));
+    }
+    REQUIRE(writer.size() == 20);
+    writer.finish();
+    REQUIRE(writer.size() == 0);
+    REQUIRE(out == batch.to_json().dump());
+    REQUIRE(chunks > 1);
+
+    // no output for notifications only
+    out.clear();
+    writer.add(jsonrpcpp::Notification("update"));
+    writer.add(jsonrpcpp::entity_ptr());
+    writer.finish();
+    REQUIRE(out.empty());
+
+    jsonrpcpp::Parser parser;
+    parser.register_request_callback("square", [](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        return make_shared<jsonrpcpp::Response>(id, params.get<int>(0) * params.get<int>(0));
+    });
+    out.clear();
+    parser.parse_streaming(R"([{"jsonrpc": "2.0", "method": "square", "params": [3], "id": 1},
+                               {"jsonrpc": "2.0", "method": "update"},
+                               {"jsonrpc": "2.0", "method": "square", "params": [4], "id": 2}])",
+                           std::ref(writer));
+    writer.finish();
+    REQUIRE(nlohmann::json::parse(out) == nlohmann::json::parse(R"([{"jsonrpc": "2.0", "result": 9, "id": 1}, {"jsonrpc": "2.0", "result": 16, "id": 2}])"));
+
+    out.clear();
+    parser.parse_streaming(R"([{"jsonrpc": "2.0", "method": "update"}, {"jsonrpc": "2.0", "method": "update"}])", std::ref(writer));
+    writer.finish();
+    REQUIRE(out.empty());
+
+    // the reply to a single message is not wrapped in a batch
+    parser.parse_streaming(R"({"jsonrpc": "2.0", "method": "square", "params": [5], "id": 3})", std::ref(writer));
+    REQUIRE(nlohmann::json::parse(out) == nlohmann::json::parse(R"({"jsonrpc": "2.0", "result": 25, "id": 3})"));
+    writer.finish();
+    REQUIRE(nlohmann::json::parse(out).is_object());
+
+    // requests without callback and invalid elements are answered with errors
+    out.clear();
+    parser.parse_streaming(R"([{"jsonrpc": "2.0", "method": "unknown", "id": 4}, 1, {"jsonrpc": "2.0", "method": "square", "params": [2], "id": 5}])",
+                           std::ref(writer));
+    writer.finish();
+    nlohmann::json replies = nlohmann::json::parse(out);
+    REQUIRE(replies.size() == 3);
+    REQUIRE(replies[0]["error"]["code"] == -32601);
+    REQUIRE(replies[0]["id"] == 4);
+    REQUIRE(replies[1]["error"]["code"] == -32600);
+    REQUIRE(replies[1]["id"].is_null());
+    REQUIRE(replies[2]["result"] == 4);
+    out.clear();
+    parser.parse_streaming(R"({"jsonrpc": "2.0", "method": "unknown", "id": 6})", std::ref(writer));
+    replies = nlohmann::json::parse(out);
+    REQUIRE(replies["error"]["code"] == -32601);
+    REQUIRE(replies["id"] == 6);
+}
+
+#ifdef JSONRPCPP_HAS_CPP_17
+namespace
+{
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+    size_t outstanding = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+} // namespace
+
+
+TEST_CASE("Memory resource")
+{
+    CountingResource resource;
+    {
+        jsonrpcpp::MemoryResourceScope scope(&resource);
+        REQUIRE(jsonrpcpp::current_memory_resource() == &resource);
+        jsonrpcpp::pmr_json json = jsonrpcpp::pmr_json::parse(R"({"a": [1, 2, {"b": "c"}]})");
+        REQUIRE(json["a"][2]["b"] == "c");
+        REQUIRE(resource.allocations > 0);
+    }
+    REQUIRE(resource.outstanding == 0);
+    REQUIRE(jsonrpcpp::current_memory_resource() == std::pmr::get_default_resource());
+
+    jsonrpcpp::Parser parser;
+    std::pmr::memory_resource* handler_resource = nullptr;
+    parser.register_request_callback("sum", [&handler_resource](const jsonrpcpp::Id& id, const jsonrpcpp::Parameter& params) {
+        handler_resource = jsonrpcpp::current_memory_resource();
+        return jsonrpcpp::make_entity<jsonrpcpp::Response>(id, params.get(0).get<int>() + params.get(1).get<int>());
+    });
+
+    resource.allocations = 0;
+    const std::string request = R"({"jsonrpc": "2.0", "method": "sum", "params": [1, 2], "id": 1})";
+    jsonrpcpp::entity_ptr entity = parser.parse(request.data(), request.size(), &resource);
+    REQUIRE(handler_resource == &resource);
+    REQUIRE(entity->is_response());
+    REQUIRE(entity->to_json()["result"] == 3);
+    REQUIRE(resource.allocations > 0);
+    REQUIRE(resource.outstanding > 0);
+    entity.reset();
+    REQUIRE(resource.outstanding == 0);
+
+    resource.allocations = 0;
+    jsonrpcpp::response_ptr response = jsonrpcpp::allocate_entity<jsonrpcpp::Response>(&resource, jsonrpcpp::Id(2), "ok");
+    REQUIRE(response->result() == "ok");
+    REQUIRE(resource.allocations > 0);
+    response.reset();
+    REQUIRE(resource.outstanding == 0);
+
+    entity = jsonrpcpp::Parser::do_parse(request.data(), request.size(), &resource);
+    REQUIRE(entity->is_request());
+}
+#endif